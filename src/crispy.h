@@ -54,6 +54,7 @@ typedef struct
 	int demobar;
 	int extautomap;
 	int flipcorpses;
+	int fpslimit;
 	int freeaim;
 	int freelook;
 	int hires;
@@ -54,6 +54,7 @@
 #include "m_menu.h"
 #include "p_saveg.h"
 
+#include "i_capture.h"
 #include "i_endoom.h"
 #include "i_input.h"
 #include "i_joystick.h"
@@ -79,6 +80,7 @@
 
 
 #include "d_main.h"
+#include "d_profile.h" // [crispy] frame profiler
 
 //
 // D-DoomLoop()
@@ -222,7 +224,9 @@ boolean D_Display (void)
 	    redrawsbar = true;
 	if (inhelpscreensstate && !inhelpscreens)
 	    redrawsbar = true;              // just put away the help screen
+	D_ProfileBegin(PROF_HUD);
 	ST_Drawer (viewheight == SCREENHEIGHT, redrawsbar );
+	D_ProfileEnd(PROF_HUD);
 	fullscreen = viewheight == SCREENHEIGHT;
 	break;
 
@@ -249,13 +253,21 @@ boolean D_Display (void)
 
         // [crispy] Crispy HUD
         if (screenblocks >= CRISPY_HUD)
+        {
+            D_ProfileBegin(PROF_HUD);
             ST_Drawer(false, true);
+            D_ProfileEnd(PROF_HUD);
+        }
     }
 
     // [crispy] in automap overlay mode,
     // the HUD is drawn on top of everything else
     if (gamestate == GS_LEVEL && gametic && !(automapactive && crispy->automapoverlay))
+    {
+	D_ProfileBegin(PROF_HUD);
 	HU_Drawer ();
+	D_ProfileEnd(PROF_HUD);
+    }
     
     // clean up border stuff
     if (gamestate != oldgamestate && gamestate != GS_LEVEL)
@@ -338,7 +350,9 @@ boolean D_Display (void)
 
 
     // menus go directly to the screen
+    D_ProfileBegin(PROF_HUD);
     M_Drawer ();          // menu is drawn even on top of everything
+    D_ProfileEnd(PROF_HUD);
     NetUpdate ();         // send out any new accumulation
 
     return wipe;
@@ -417,6 +431,7 @@ void D_BindVariables(void)
     M_BindIntVariable("show_messages",          &showMessages);
     M_BindIntVariable("screenblocks",           &screenblocks);
     M_BindIntVariable("detaillevel",            &detailLevel);
+    M_BindIntVariable("dynamic_resolution",     &dynamic_resolution);
     M_BindIntVariable("snd_channels",           &snd_channels);
     // [crispy] unconditionally disable savegame and demo limits
 //  M_BindIntVariable("vanilla_savegame_limit", &vanilla_savegame_limit);
@@ -460,6 +475,7 @@ void D_BindVariables(void)
     M_BindIntVariable("crispy_demotimerdir",    &crispy->demotimerdir);
     M_BindIntVariable("crispy_extautomap",      &crispy->extautomap);
     M_BindIntVariable("crispy_flipcorpses",     &crispy->flipcorpses);
+    M_BindIntVariable("crispy_fpslimit",        &crispy->fpslimit);
     M_BindIntVariable("crispy_freeaim",         &crispy->freeaim);
     M_BindIntVariable("crispy_freelook",        &crispy->freelook);
     M_BindIntVariable("crispy_hires",           &crispy->hires);
@@ -535,9 +551,13 @@ void D_RunFrame()
         I_UpdateNoBlit ();
         M_Drawer ();                            // menu is drawn even on top of wipes
         I_FinishUpdate ();                      // page flip or blit buffer
+        D_ProfileFrame ();
         return;
     }
 
+    // [crispy] wait for the next frame if the framerate is limited
+    I_PaceFrame (crispy->uncapped ? crispy->fpslimit : 0);
+
     // frame syncronous IO operations
     I_StartFrame ();
 
@@ -548,6 +568,8 @@ void D_RunFrame()
     // Update display, next frame, with current state if no profiling is on
     if (screenvisible && !nodrawers)
     {
+        const uint64_t displaystart = I_GetTimeUS();
+
         if ((wipe = D_Display ()))
         {
             // start wipe on this frame
@@ -555,11 +577,23 @@ void D_RunFrame()
 
             wipestart = I_GetTime () - 1;
         } else {
+            // [crispy] adapt the detail level to the time the frame took,
+            // which says nothing about the game when rendering in batch
+            if (!I_VirtualClock())
+            {
+                R_DynamicResolution((int) (I_GetTimeUS() - displaystart));
+            }
+
             // normal update
+            D_ProfileBegin(PROF_BLIT);
             I_FinishUpdate ();              // page flip or blit buffer
+            D_ProfileEnd(PROF_BLIT);
         }
     }
 
+    // [crispy] frame profiler
+    D_ProfileFrame ();
+
 	// [crispy] post-rendering function pointer to apply config changes
 	// that affect rendering and that are better applied after the current
 	// frame has finished rendering
@@ -594,6 +628,7 @@ void D_DoomLoop (void)
     I_GraphicsCheckCommandLine();
     I_SetGrabMouseCallback(D_GrabMouseCallback);
     I_InitGraphics();
+    I_InitCapture(); // [crispy] real-time capture
     EnableLoadingDisk();
 
     TryRunTics();
@@ -2035,6 +2070,7 @@ void D_DoomMain (void)
 
     DEH_printf("I_Init: Setting up machine state.\n");
     I_CheckIsScreensaver();
+    I_CaptureCheckCommandLine(); // [crispy] batch rendering
     I_InitTimer();
     I_InitJoystick();
     I_InitSound(true);
@@ -2286,6 +2322,9 @@ void D_DoomMain (void)
         DEH_printf("External statistics registered.\n");
     }
 
+    // [crispy] frame profiler
+    D_InitFrameProfile();
+
     //!
     // @arg <x>
     // @category demo
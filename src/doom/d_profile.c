@@ -0,0 +1,375 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[crispy] Per-phase frame time profiler. The phases are timed
+//	when the profile overlay is shown, i.e. when the "showfps"
+//	cheat has been entered twice, or when -frameprofile writes
+//	them to a CSV file.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "p_local.h" // [crispy] thinkerpools[], sightcache
+#include "r_data.h"
+
+#include "d_profile.h"
+
+boolean frameprofiling = false;
+
+static FILE *profilefile = NULL;
+static unsigned int profileframes;
+
+static const char *const phasenames[NUMPROFPHASES] =
+{
+    "bsp", "planes", "masked", "hud", "blit", "frame"
+};
+
+static uint64_t framestart;
+static uint64_t phasestart[NUMPROFPHASES];
+static uint64_t phasetime[NUMPROFPHASES];
+
+// sums over the last second, for the overlay
+static uint64_t phasesum[NUMPROFPHASES];
+static int phasesumframes;
+static int phaseaverage[NUMPROFPHASES];
+
+// [crispy] frame times of the timedemo, in microseconds
+static uint32_t *demoframes = NULL;
+static int numdemoframes, maxdemoframes;
+
+// upper bounds of the frame time histogram buckets, in milliseconds,
+// the last bucket takes all the longer frames
+static const int histogrambounds[] = {1, 2, 4, 8, 16, 32, 64, 128};
+#define NUMHISTOGRAMBUCKETS (arrlen(histogrambounds) + 1)
+
+static void D_RecordDemoFrame (uint64_t us)
+{
+    if (numdemoframes == maxdemoframes)
+    {
+	maxdemoframes = maxdemoframes ? 2 * maxdemoframes : 4096;
+	demoframes = I_Realloc(demoframes, maxdemoframes * sizeof(*demoframes));
+    }
+
+    demoframes[numdemoframes++] = (uint32_t) MIN(us, UINT32_MAX);
+}
+
+static void D_CloseFrameProfile (void)
+{
+    if (profilefile)
+    {
+	fclose(profilefile);
+	profilefile = NULL;
+    }
+}
+
+void D_InitFrameProfile (void)
+{
+    int i, p;
+
+    //!
+    // @arg <file>
+    // @category video
+    //
+    // Time the rendering phases of every frame and write the
+    // times in microseconds to file, as comma-separated values.
+    //
+
+    p = M_CheckParmWithArgs("-frameprofile", 1);
+
+    if (p > 0)
+    {
+	profilefile = fopen(myargv[p+1], "w");
+
+	if (profilefile == NULL)
+	{
+	    I_Error("D_InitFrameProfile: Could not open %s", myargv[p+1]);
+	}
+
+	fprintf(profilefile, "frame,gametic");
+	for (i = 0; i < NUMPROFPHASES; i++)
+	{
+	    fprintf(profilefile, ",%s_us", phasenames[i]);
+	}
+	fprintf(profilefile, ",composite_hits,composite_misses,composite_evictions,composite_bytes\n");
+
+	I_AtExit(D_CloseFrameProfile, true);
+	frameprofiling = true;
+    }
+
+    framestart = I_GetTimeUS();
+}
+
+void D_ProfileBegin (profphase_t phase)
+{
+    if (frameprofiling)
+    {
+	phasestart[phase] = I_GetTimeUS();
+    }
+}
+
+void D_ProfileEnd (profphase_t phase)
+{
+    if (frameprofiling)
+    {
+	phasetime[phase] += I_GetTimeUS() - phasestart[phase];
+    }
+}
+
+void D_ProfileFrame (void)
+{
+    const uint64_t now = I_GetTimeUS();
+    boolean profiling;
+    int i;
+
+    if (frameprofiling)
+    {
+	phasetime[PROF_FRAME] = now - framestart;
+
+	if (profilefile)
+	{
+	    fprintf(profilefile, "%u,%d", profileframes, gametic);
+	    for (i = 0; i < NUMPROFPHASES; i++)
+	    {
+		fprintf(profilefile, ",%" PRIu64, phasetime[i]);
+	    }
+	    fprintf(profilefile, ",%u,%u,%u,%d\n",
+	            compositecache.hits, compositecache.misses,
+	            compositecache.evictions, compositecache.bytes);
+	}
+	profileframes++;
+
+	for (i = 0; i < NUMPROFPHASES; i++)
+	{
+	    phasesum[i] += phasetime[i];
+	}
+	phasesumframes++;
+
+	// update the overlay once per second, like the FPS counter
+	if (phasesum[PROF_FRAME] >= 1000000)
+	{
+	    for (i = 0; i < NUMPROFPHASES; i++)
+	    {
+		phaseaverage[i] = (int) (phasesum[i] / phasesumframes);
+	    }
+
+	    memset(phasesum, 0, sizeof(phasesum));
+	    phasesumframes = 0;
+	}
+    }
+
+    // the first frame of the timedemo also loads the level
+    if (timingdemo && demoplayback)
+    {
+	D_RecordDemoFrame(now - framestart);
+    }
+
+    memset(phasetime, 0, sizeof(phasetime));
+    framestart = now;
+
+    // only switch on or off between two frames
+    profiling = profilefile != NULL || players[displayplayer].powers[pw_showfps] > 1;
+
+    if (profiling && !frameprofiling)
+    {
+	memset(phasesum, 0, sizeof(phasesum));
+	memset(phaseaverage, 0, sizeof(phaseaverage));
+	phasesumframes = 0;
+    }
+
+    frameprofiling = profiling;
+}
+
+int D_ProfileAverage (profphase_t phase)
+{
+    return phaseaverage[phase];
+}
+
+static int CompareFrameTimes (const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *) a;
+    const uint32_t y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of the sorted frame times
+static uint32_t FramePercentile (int percent)
+{
+    const int rank = (numdemoframes * percent + 99) / 100;
+
+    return demoframes[MAX(rank, 1) - 1];
+}
+
+void D_TimeDemoReport (int gametics, int realtics)
+{
+    int histogram[NUMHISTOGRAMBUCKETS] = {0};
+    uint32_t p50, p95, p99;
+    uint64_t sum = 0;
+    double avg;
+    FILE *json;
+    int i, j, p;
+
+    if (numdemoframes == 0)
+    {
+	return;
+    }
+
+    qsort(demoframes, numdemoframes, sizeof(*demoframes), CompareFrameTimes);
+
+    for (i = 0; i < numdemoframes; i++)
+    {
+	sum += demoframes[i];
+
+	for (j = 0; j < NUMHISTOGRAMBUCKETS - 1; j++)
+	{
+	    if (demoframes[i] < histogrambounds[j] * 1000)
+	    {
+		break;
+	    }
+	}
+	histogram[j]++;
+    }
+
+    avg = (double) sum / numdemoframes;
+    p50 = FramePercentile(50);
+    p95 = FramePercentile(95);
+    p99 = FramePercentile(99);
+
+    printf("Frame times of %d frames in ms:\n", numdemoframes);
+    printf("  min %.3f  avg %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+           demoframes[0] / 1000.0, avg / 1000.0, p50 / 1000.0,
+           p95 / 1000.0, p99 / 1000.0, demoframes[numdemoframes - 1] / 1000.0);
+
+    for (j = 0; j < NUMHISTOGRAMBUCKETS; j++)
+    {
+	const int bar = (histogram[j] * 50 + numdemoframes - 1) / numdemoframes;
+
+	if (j < NUMHISTOGRAMBUCKETS - 1)
+	{
+	    printf("  < %3d ms %7d ", histogrambounds[j], histogram[j]);
+	}
+	else
+	{
+	    printf("  >=%3d ms %7d ", histogrambounds[j - 1], histogram[j]);
+	}
+
+	for (i = 0; i < bar; i++)
+	{
+	    putchar('#');
+	}
+	putchar('\n');
+    }
+
+    printf("Composite textures: %u hits, %u misses, %u evictions, %d KiB",
+           compositecache.hits, compositecache.misses,
+           compositecache.evictions, compositecache.bytes >> 10);
+    if (compositecache.budget > 0)
+    {
+	printf(" of %d KiB", compositecache.budget >> 10);
+    }
+    printf("\n");
+
+    // [crispy] thinker pools
+    printf("Peak thinkers:");
+    for (j = 0; j < NUMTHINKERPOOLS; j++)
+    {
+	printf(" %d %s", thinkerpools[j].peak, thinkerpools[j].name);
+    }
+    printf("\n");
+
+    // [crispy] memoised sight checks
+    printf("Sight checks: %u hits, %u misses\n",
+           sightcache.hits, sightcache.misses);
+
+    //!
+    // @arg <file>
+    // @category video
+    //
+    // Write the results of -timedemo to file as JSON, including the
+    // frame time percentiles and histogram.
+    //
+
+    p = M_CheckParmWithArgs("-timedemojson", 1);
+
+    if (p <= 0)
+    {
+	return;
+    }
+
+    json = fopen(myargv[p+1], "w");
+
+    if (json == NULL)
+    {
+	fprintf(stderr, "D_TimeDemoReport: Could not open %s\n", myargv[p+1]);
+	return;
+    }
+
+    fprintf(json, "{\n");
+    fprintf(json, "  \"gametics\": %d,\n", gametics);
+    fprintf(json, "  \"realtics\": %d,\n", realtics);
+    fprintf(json, "  \"fps\": %.3f,\n", (double) gametics * TICRATE / MAX(realtics, 1));
+    fprintf(json, "  \"frames\": %d,\n", numdemoframes);
+    fprintf(json, "  \"frametime_us\": {\n");
+    fprintf(json, "    \"min\": %u,\n", (unsigned int) demoframes[0]);
+    fprintf(json, "    \"avg\": %.1f,\n", avg);
+    fprintf(json, "    \"p50\": %u,\n", (unsigned int) p50);
+    fprintf(json, "    \"p95\": %u,\n", (unsigned int) p95);
+    fprintf(json, "    \"p99\": %u,\n", (unsigned int) p99);
+    fprintf(json, "    \"max\": %u\n", (unsigned int) demoframes[numdemoframes - 1]);
+    fprintf(json, "  },\n");
+    fprintf(json, "  \"histogram\": [\n");
+    for (j = 0; j < NUMHISTOGRAMBUCKETS; j++)
+    {
+	// the last bucket has no upper bound
+	if (j < NUMHISTOGRAMBUCKETS - 1)
+	{
+	    fprintf(json, "    {\"below_ms\": %d, \"frames\": %d},\n",
+	            histogrambounds[j], histogram[j]);
+	}
+	else
+	{
+	    fprintf(json, "    {\"below_ms\": null, \"frames\": %d}\n",
+	            histogram[j]);
+	}
+    }
+    fprintf(json, "  ],\n");
+    fprintf(json, "  \"composite_cache\": {\n");
+    fprintf(json, "    \"hits\": %u,\n", compositecache.hits);
+    fprintf(json, "    \"misses\": %u,\n", compositecache.misses);
+    fprintf(json, "    \"evictions\": %u,\n", compositecache.evictions);
+    fprintf(json, "    \"bytes\": %d,\n", compositecache.bytes);
+    fprintf(json, "    \"budget\": %d\n", compositecache.budget);
+    fprintf(json, "  },\n");
+    fprintf(json, "  \"sight_cache\": {\n");
+    fprintf(json, "    \"hits\": %u,\n", sightcache.hits);
+    fprintf(json, "    \"misses\": %u\n", sightcache.misses);
+    fprintf(json, "  },\n");
+    fprintf(json, "  \"peak_thinkers\": {\n");
+    for (j = 0; j < NUMTHINKERPOOLS; j++)
+    {
+	fprintf(json, "    \"%s\": %d%s\n", thinkerpools[j].name,
+	        thinkerpools[j].peak, j < NUMTHINKERPOOLS - 1 ? "," : "");
+    }
+    fprintf(json, "  }\n");
+    fprintf(json, "}\n");
+
+    fclose(json);
+}
@@ -0,0 +1,55 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[crispy] Per-phase frame time profiler
+//
+
+#ifndef __D_PROFILE__
+#define __D_PROFILE__
+
+#include "doomtype.h"
+
+typedef enum
+{
+    PROF_BSP,     // R_RenderBSPNode(), or all of the render threads
+    PROF_PLANES,  // R_DrawPlanes()
+    PROF_MASKED,  // R_DrawMasked() and the player sprites
+    PROF_HUD,     // status bar, HUD and menu
+    PROF_BLIT,    // I_FinishUpdate()
+    PROF_FRAME,   // the whole frame, from one D_ProfileFrame() to the next
+
+    NUMPROFPHASES
+} profphase_t;
+
+// true while the phases are being timed
+extern boolean frameprofiling;
+
+void D_InitFrameProfile (void);
+
+void D_ProfileBegin (profphase_t phase);
+void D_ProfileEnd (profphase_t phase);
+
+// Called once at the end of each frame.
+void D_ProfileFrame (void);
+
+// Time spent in a phase per frame in microseconds,
+// averaged over the last second.
+int D_ProfileAverage (profphase_t phase);
+
+// Print the frame time statistics of the timedemo,
+// and write them to the -timedemojson file.
+void D_TimeDemoReport (int gametics, int realtics);
+
+#endif
@@ -146,6 +146,7 @@ extern  boolean	paused;		// Game Pause?
 extern  boolean		viewactive;
 
 extern  boolean		nodrawers;
+extern  boolean		timingdemo; // [crispy] for D_ProfileFrame()
 
 
 extern  boolean         testcontrols;
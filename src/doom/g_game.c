@@ -76,6 +76,7 @@
 
 #include "g_game.h"
 #include "v_trans.h" // [crispy] colored "always run" message
+#include "d_profile.h" // [crispy] D_TimeDemoReport()
 
 
 #define SAVEGAMESIZE	0x2c000
@@ -3142,6 +3143,9 @@ boolean G_CheckDemoStatus (void)
         G_SaveGame(9, "test_result");
         G_DoSaveGame();
 
+        // [crispy] frame time statistics
+        D_TimeDemoReport(gametic, realtics);
+
 	I_Error ("timed %i gametics in %i realtics (%f fps)",
                  gametic, realtics, fps);
     } 
@@ -28,6 +28,7 @@
 #include "i_input.h"
 #include "i_swap.h"
 #include "i_video.h"
+#include "i_timer.h" // [crispy] I_FramePacing()
 
 #include "hu_stuff.h"
 #include "hu_lib.h"
@@ -49,6 +50,7 @@
 #include "r_state.h" // [crispy] colormaps
 #include "v_video.h" // [crispy] V_DrawPatch() et al.
 #include "v_trans.h" // [crispy] colored kills/items/secret/etc. messages
+#include "d_profile.h" // [crispy] D_ProfileAverage()
 
 //
 // Locally used constants, shortcuts.
@@ -96,6 +98,7 @@ static hu_textline_t	w_coordx;
 static hu_textline_t	w_coordy;
 static hu_textline_t	w_coorda;
 static hu_textline_t	w_fps;
+static hu_textline_t	w_prof; // [crispy] frame profiler
 boolean			chat_on;
 static hu_itext_t	w_chat;
 static boolean		always_off = false;
@@ -669,6 +672,12 @@ void HU_Start(void)
 		       hu_font,
 		       HU_FONTSTART);
 
+    // [crispy] below the player coordinates
+    HUlib_initTextLine(&w_prof,
+		       HU_COORDX, HU_MSGY + 4 * 8,
+		       hu_font,
+		       HU_FONTSTART);
+
     
     switch ( logical_gamemission )
     {
@@ -884,6 +893,11 @@ void HU_Drawer(void)
 	HUlib_drawTextLine(&w_fps, false);
     }
 
+    if (plr->powers[pw_showfps] > 1)
+    {
+	HUlib_drawTextLine(&w_prof, false);
+    }
+
     if (crispy->crosshair == CROSSHAIR_STATIC)
 	HU_DrawCrosshair();
 
@@ -923,6 +937,7 @@ void HU_Erase(void)
     HUlib_eraseTextLine(&w_coordy);
     HUlib_eraseTextLine(&w_coorda);
     HUlib_eraseTextLine(&w_fps);
+    HUlib_eraseTextLine(&w_prof);
 
 }
 
@@ -1150,6 +1165,40 @@ void HU_Ticker(void)
 	while (*s)
 	    HUlib_addCharToTextLine(&w_fps, *(s++));
     }
+
+    // [crispy] frame profiler, milliseconds per frame for each phase
+    if (plr->powers[pw_showfps] > 1)
+    {
+	static const char *const labels[NUMPROFPHASES] =
+	{
+	    "BSP", "PLN", "SPR", "HUD", "BLT", "TOT"
+	};
+	char prof[HU_MAXLINELENGTH + 1];
+	int i, len;
+
+	len = M_snprintf(prof, sizeof(prof), "%s", crstr[CR_GRAY]);
+	for (i = 0; i < NUMPROFPHASES; i++)
+	{
+	    const int us = D_ProfileAverage(i);
+
+	    len += M_snprintf(prof + len, sizeof(prof) - len, "%s%s\t%d.%d",
+	                      i ? "\n" : "", labels[i], us / 1000, (us / 100) % 10);
+	}
+
+	// [crispy] standard deviation of the time between two frames
+	{
+	    int avg, dev;
+
+	    I_FramePacing(&avg, &dev);
+	    M_snprintf(prof + len, sizeof(prof) - len, "\nDEV\t%d.%d",
+	               dev / 1000, (dev / 100) % 10);
+	}
+
+	HUlib_clearTextLine(&w_prof);
+	s = prof;
+	while (*s)
+	    HUlib_addCharToTextLine(&w_prof, *(s++));
+    }
 }
 
 #define QUEUESIZE		128
@@ -159,7 +159,7 @@ static void P_ReadFireFlicker (const char *key)
 	{
 		fireflicker_t *flick;
 
-		flick = Z_Malloc(sizeof(*flick), PU_LEVEL, NULL);
+		flick = P_AllocThinker(POOL_FIREFLICKER);
 
 		flick->sector = &sectors[sector];
 		flick->count = count;
@@ -73,6 +73,37 @@ void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
 
+// [crispy] thinkers are allocated from one pool per type
+typedef enum
+{
+    POOL_MOBJ,
+    POOL_CEILING,
+    POOL_DOOR,
+    POOL_FLOOR,
+    POOL_PLAT,
+    POOL_FIREFLICKER,
+    POOL_LIGHTFLASH,
+    POOL_STROBE,
+    POOL_GLOW,
+
+    NUMTHINKERPOOLS
+} thinkerpool_t;
+
+typedef struct
+{
+    const char *name;
+    int live;   // thinkers allocated right now
+    int peak;   // most thinkers allocated at once, over all levels
+} thinkerpoolstats_t;
+
+extern thinkerpoolstats_t thinkerpools[NUMTHINKERPOOLS];
+
+void *P_AllocThinker (thinkerpool_t pool);
+void P_FreeThinker (thinker_t* thinker);
+
+// [crispy] forget all pools, called when Z_FreeTags() has freed their memory
+void P_ResetThinkerPools (void);
+
 
 //
 // P_PSPR
@@ -233,6 +264,20 @@ boolean P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 boolean P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 void	P_SlideMove (mobj_t* mo);
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
+
+// [crispy] memoised sight checks
+typedef struct
+{
+    unsigned int hits;      // P_CheckSight() answered from the cache
+    unsigned int misses;    // P_CheckSight() had to cross the BSP
+} sightcache_t;
+
+extern sightcache_t sightcache;
+
+void P_InitSightCache (void);
+// Called at the start of each tic and whenever a sector height changes.
+void P_InvalidateSightCache (void);
+
 void 	P_UseLines (player_t* player);
 
 boolean P_ChangeSector (sector_t* sector, boolean crunch);
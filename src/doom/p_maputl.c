@@ -23,6 +23,7 @@
 
 
 #include <stdlib.h>
+#include <string.h> // [crispy] memmove()
 
 
 #include "i_system.h" // [crispy] I_Realloc()
@@ -561,6 +562,34 @@ int		ptflags;
 
 static void InterceptsOverrun(int num_intercepts, intercept_t *intercept);
 
+// [crispy] keep the intercepts sorted by frac as they are added, so that
+// P_TraverseIntercepts() can walk them in order instead of searching for
+// the closest one on every step. The new entry at intercept_p goes behind
+// all entries with the same or a smaller frac, which is the order in which
+// the linear search used to pick them, ties included.
+static void SortInIntercept(void)
+{
+    const intercept_t in = *intercept_p;
+    intercept_t *lo = intercepts, *hi = intercept_p;
+
+    // intercepts are mostly found in order along the trace
+    if (hi == lo || (hi - 1)->frac <= in.frac)
+	return;
+
+    while (lo < hi)
+    {
+	intercept_t *const mid = lo + (hi - lo) / 2;
+
+	if (mid->frac <= in.frac)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    memmove(lo + 1, lo, (intercept_p - lo) * sizeof(*lo));
+    *lo = in;
+}
+
 // [crispy] show mapthing number in INTERCEPTS overflow warnings
 extern mobj_t* shootthing;
 
@@ -630,6 +659,7 @@ PIT_AddLineIntercepts (line_t* ld)
 	    // [crispy] print a warning
 	    fprintf(stderr, "PIT_AddLineIntercepts: Triggered INTERCEPTS overflow!\n");
     }
+    SortInIntercept(); // [crispy]
     intercept_p++;
 
     return true;	// continue
@@ -706,6 +736,7 @@ boolean PIT_AddThingIntercepts (mobj_t* thing)
 	    // [crispy] print a warning
 	    fprintf(stderr, "PIT_AddThingIntercepts: Triggered INTERCEPTS overflow!\n");
     }
+    SortInIntercept(); // [crispy]
     intercept_p++;
 
     return true;		// keep going
@@ -722,46 +753,16 @@ P_TraverseIntercepts
 ( traverser_t	func,
   fixed_t	maxfrac )
 {
-    int			count;
-    fixed_t		dist;
-    intercept_t*	scan;
     intercept_t*	in;
-	
-    count = intercept_p - intercepts;
-    
-    in = 0;			// shut up compiler warning
-	
-    while (count--)
-    {
-	dist = INT_MAX;
-	for (scan = intercepts ; scan<intercept_p ; scan++)
-	{
-	    if (scan->frac < dist)
-	    {
-		dist = scan->frac;
-		in = scan;
-	    }
-	}
-	
-	if (dist > maxfrac)
-	    return true;	// checked everything in range		
 
-#if 0  // UNUSED
+    // [crispy] the intercepts are already sorted by frac
+    for (in = intercepts ; in<intercept_p ; in++)
     {
-	// don't check these yet, there may be others inserted
-	in = scan = intercepts;
-	for ( scan = intercepts ; scan<intercept_p ; scan++)
-	    if (scan->frac > maxfrac)
-		*in++ = *scan;
-	intercept_p = in;
-	return false;
-    }
-#endif
+	if (in->frac > maxfrac)
+	    return true;	// checked everything in range
 
         if ( !func (in) )
 	    return false;	// don't bother going farther
-
-	in->frac = INT_MAX;
     }
 	
     return true;		// everything was traversed
@@ -214,6 +214,18 @@ typedef struct mobj_s
     fixed_t		y;
     fixed_t		z;
 
+    // [crispy] moved up next to the position, which P_MobjThinker()
+    // reads together with them on every tic
+
+    // Momentums, used to update position.
+    fixed_t		momx;
+    fixed_t		momy;
+    fixed_t		momz;
+
+    int			tics;	// state tic counter
+    state_t*		state;
+    int			flags;
+
     // More list: links in sector (if needed)
     struct mobj_s*	snext;
     struct mobj_s*	sprev;
@@ -238,20 +250,12 @@ typedef struct mobj_s
     fixed_t		radius;
     fixed_t		height;	
 
-    // Momentums, used to update position.
-    fixed_t		momx;
-    fixed_t		momy;
-    fixed_t		momz;
-
     // If == validcount, already checked.
     int			validcount;
 
     mobjtype_t		type;
     mobjinfo_t*		info;	// &mobjinfo[mobj->type]
     
-    int			tics;	// state tic counter
-    state_t*		state;
-    int			flags;
     int			health;
 
     // Movement direction, movement generation (zig-zagging).
@@ -0,0 +1,909 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[crispy] Sector visibility table for maps without a REJECT lump
+//
+//	Many PWADs ship an all-zero REJECT lump, which leaves the BSP
+//	traversal in P_CheckSight() as the only way to find out that two
+//	sectors can't see each other. For these maps, a table like the one
+//	node builders put into REJECT is computed when the level is loaded.
+//
+//	The subsectors are convex, so the walls of a subsector and the
+//	partition lines of the nodes above it give its exact shape. Portals
+//	are the pieces of partition lines through which one subsector borders
+//	another, minus one-sided walls. Sight is flooded from every subsector
+//	through chains of portals, as long as a straight line can still pass
+//	through all of them. Which sectors it reaches is what it may see.
+//
+//	Heights are ignored, so sectors that move never block sight. Every
+//	portal is widened a little, since the sight check itself rounds to
+//	whole map units.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_config.h"
+#include "m_misc.h"
+#include "p_local.h"
+#include "r_state.h"
+#include "sha1.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "p_pvs.h"
+
+// bump whenever the results would change, to invalidate cached tables
+#define PVSVERSION 1
+
+// portals are widened by this many map units on each side
+#define PVSSLOP 2.0
+
+// offset used to tell which side of a partition a portal is on
+#define PVSOFFSET (1.0 / 64)
+
+// flood steps allowed per subsector, before falling back to all sectors
+// that are connected to it at all
+#define PVSBUDGET 8192
+
+byte *sightpvs;
+
+typedef struct
+{
+    double x, y;
+} pvsvec_t;
+
+// a*x + b*y + c >= 0 on the inner side, with (a, b) of unit length
+typedef struct
+{
+    double a, b, c;
+} pvsplane_t;
+
+typedef struct
+{
+    pvsvec_t v[2];
+    int cell[2];    // subsectors on either side
+} pvsportal_t;
+
+typedef struct
+{
+    int cell;
+    double t0, t1;  // part of the partition line it borders
+} pvspiece_t;
+
+static pvsportal_t *portals;
+static int numportals, maxportals;
+
+static pvsplane_t *nodeplanes;  // front side of each node
+static pvsplane_t *segplanes;   // front side of each seg
+
+static pvsplane_t *planestack;  // region of the current node
+static int numplanes;
+
+static pvspiece_t *pieces[2];   // front and back pieces of a partition
+static int numpieces[2], maxpieces[2];
+
+static int *cellfirst;          // first portal of each subsector
+static int *cellportals;        // portal numbers, by subsector
+
+static byte *visible;           // numsectors x numsectors bits
+static byte *visrow;            // sectors seen from the current subsector
+static byte *onpath;            // subsectors on the current flood path
+static int *floodqueue;
+static int floodsteps;
+
+static void PlaneThrough (pvsplane_t *pl, double x, double y,
+                          double dx, double dy)
+{
+    const double len = sqrt(dx * dx + dy * dy);
+
+    if (len == 0)
+    {
+	// degenerate, all points are on it
+	pl->a = pl->b = pl->c = 0;
+	return;
+    }
+
+    // the front side is the right side, as in R_PointOnSide()
+    pl->a = dy / len;
+    pl->b = -dx / len;
+    pl->c = -(pl->a * x + pl->b * y);
+}
+
+static inline double PlaneDist (const pvsplane_t *pl, const pvsvec_t *v)
+{
+    return pl->a * v->x + pl->b * v->y + pl->c;
+}
+
+static inline pvsvec_t Lerp (const pvsvec_t *v, double t)
+{
+    pvsvec_t r;
+
+    r.x = v[0].x + t * (v[1].x - v[0].x);
+    r.y = v[0].y + t * (v[1].y - v[0].y);
+
+    return r;
+}
+
+// Cut off the part of a line segment that is more than slop
+// behind the plane. Returns false if nothing is left.
+static boolean ClipToPlane (pvsvec_t *v, const pvsplane_t *pl, double slop)
+{
+    const double d0 = PlaneDist(pl, &v[0]) + slop;
+    const double d1 = PlaneDist(pl, &v[1]) + slop;
+
+    if (d0 >= 0 && d1 >= 0)
+    {
+	return true;
+    }
+
+    if (d0 < 0 && d1 < 0)
+    {
+	return false;
+    }
+
+    v[d0 < 0 ? 0 : 1] = Lerp(v, d0 / (d0 - d1));
+
+    return true;
+}
+
+static int CellNum (int child)
+{
+    return child == -1 ? 0 : (int) (child & ~NF_SUBSECTOR);
+}
+
+static void AddPiece (int side, int cell, double t0, double t1)
+{
+    if (numpieces[side] == maxpieces[side])
+    {
+	maxpieces[side] = maxpieces[side] ? 2 * maxpieces[side] : 64;
+	pieces[side] = I_Realloc(pieces[side], maxpieces[side] * sizeof(**pieces));
+    }
+
+    pieces[side][numpieces[side]].cell = cell;
+    pieces[side][numpieces[side]].t0 = t0;
+    pieces[side][numpieces[side]].t1 = t1;
+    numpieces[side]++;
+}
+
+// Split the part [t0, t1] of a partition line among the subsectors
+// below the given node that border it. The line is shifted by off
+// to the side that the node is on.
+static void SplitPartition (int side, int bspnum, const pvsvec_t *v,
+                            double t0, double t1, const pvsvec_t *off)
+{
+    while (!(bspnum & NF_SUBSECTOR))
+    {
+	const node_t *const node = &nodes[bspnum];
+	const pvsplane_t *const pl = &nodeplanes[bspnum];
+	pvsvec_t p0 = Lerp(v, t0), p1 = Lerp(v, t1);
+	double d0, d1, tm;
+
+	p0.x += off->x; p0.y += off->y;
+	p1.x += off->x; p1.y += off->y;
+	d0 = PlaneDist(pl, &p0);
+	d1 = PlaneDist(pl, &p1);
+
+	if (d0 >= 0 && d1 >= 0)
+	{
+	    bspnum = node->children[0];
+	}
+	else if (d0 <= 0 && d1 <= 0)
+	{
+	    bspnum = node->children[1];
+	}
+	else
+	{
+	    tm = t0 + (t1 - t0) * d0 / (d0 - d1);
+	    SplitPartition(side, node->children[d0 > 0 ? 0 : 1], v, t0, tm, off);
+	    bspnum = node->children[d0 > 0 ? 1 : 0];
+	    t0 = tm;
+	}
+    }
+
+    AddPiece(side, CellNum(bspnum), t0, t1);
+}
+
+static boolean SegBlocksSight (const seg_t *seg)
+{
+    // as in P_CrossSubsector()
+    return seg->linedef->backsector == NULL
+        || !(seg->linedef->flags & ML_TWOSIDED);
+}
+
+// Add the portal between two subsectors through the part of a partition
+// line between a and b, where it is not covered by a one-sided wall.
+static void AddPortal (int cell0, int cell1, pvsvec_t a, pvsvec_t b)
+{
+    const int cells[2] = {cell0, cell1};
+    double open[64][2];
+    int numopen;
+    pvsvec_t v[2];
+    double len, slop;
+    int i, j, k;
+
+    v[0] = a;
+    v[1] = b;
+
+    // only the part that is inside both subsectors
+    for (i = 0; i < 2; i++)
+    {
+	const subsector_t *const sub = &subsectors[cells[i]];
+
+	for (j = sub->firstline; j < sub->firstline + sub->numlines; j++)
+	{
+	    if (!ClipToPlane(v, &segplanes[j], PVSSLOP))
+	    {
+		return;
+	    }
+	}
+    }
+
+    len = sqrt((v[1].x - v[0].x) * (v[1].x - v[0].x)
+             + (v[1].y - v[0].y) * (v[1].y - v[0].y));
+    slop = len > 0 ? PVSSLOP / len : 0;
+
+    open[0][0] = 0;
+    open[0][1] = 1;
+    numopen = 1;
+
+    // remove the parts covered by one-sided walls
+    for (i = 0; i < 2 && len > 0; i++)
+    {
+	const subsector_t *const sub = &subsectors[cells[i]];
+
+	for (j = sub->firstline; j < sub->firstline + sub->numlines; j++)
+	{
+	    const seg_t *const seg = &segs[j];
+	    double s0, s1;
+
+	    if (!SegBlocksSight(seg)
+	        || fabs(PlaneDist(&segplanes[j], &v[0])) > PVSSLOP
+	        || fabs(PlaneDist(&segplanes[j], &v[1])) > PVSSLOP)
+	    {
+		continue;
+	    }
+
+	    s0 = ((seg->v1->x / (double) FRACUNIT - v[0].x) * (v[1].x - v[0].x)
+	        + (seg->v1->y / (double) FRACUNIT - v[0].y) * (v[1].y - v[0].y))
+	       / (len * len);
+	    s1 = ((seg->v2->x / (double) FRACUNIT - v[0].x) * (v[1].x - v[0].x)
+	        + (seg->v2->y / (double) FRACUNIT - v[0].y) * (v[1].y - v[0].y))
+	       / (len * len);
+
+	    if (s0 > s1)
+	    {
+		const double s = s0;
+		s0 = s1;
+		s1 = s;
+	    }
+
+	    s0 += slop;
+	    s1 -= slop;
+
+	    for (k = 0; k < numopen && s0 < s1; k++)
+	    {
+		if (s1 <= open[k][0] || s0 >= open[k][1])
+		{
+		    continue;
+		}
+
+		if (s0 > open[k][0] && s1 < open[k][1])
+		{
+		    // split in two, keep it open if out of room
+		    if (numopen < arrlen(open))
+		    {
+			open[numopen][0] = s1;
+			open[numopen][1] = open[k][1];
+			numopen++;
+			open[k][1] = s0;
+		    }
+		}
+		else if (s0 > open[k][0])
+		{
+		    open[k][1] = s0;
+		}
+		else if (s1 < open[k][1])
+		{
+		    open[k][0] = s1;
+		}
+		else
+		{
+		    open[k][0] = open[--numopen][0];
+		    open[k][1] = open[numopen][1];
+		    k--;
+		}
+	    }
+	}
+    }
+
+    for (k = 0; k < numopen; k++)
+    {
+	pvsportal_t *portal;
+
+	if (numportals == maxportals)
+	{
+	    maxportals = maxportals ? 2 * maxportals : 1024;
+	    portals = I_Realloc(portals, maxportals * sizeof(*portals));
+	}
+
+	portal = &portals[numportals++];
+	portal->v[0] = Lerp(v, open[k][0] - slop);
+	portal->v[1] = Lerp(v, open[k][1] + slop);
+	portal->cell[0] = cell0;
+	portal->cell[1] = cell1;
+    }
+}
+
+static int ComparePieces (const void *a, const void *b)
+{
+    const pvspiece_t *const pa = a, *const pb = b;
+
+    return (pa->t0 > pb->t0) - (pa->t0 < pb->t0);
+}
+
+static void BuildPortals (int bspnum, double size)
+{
+    const node_t *const node = &nodes[bspnum];
+    pvsplane_t *pl;
+    int side;
+
+    pl = &nodeplanes[bspnum];
+
+    if (pl->a != 0 || pl->b != 0)
+    {
+	pvsvec_t v[2], off[2];
+	int i;
+
+	// the partition line, within the region of this node
+	v[0].x = node->x / (double) FRACUNIT + pl->b * size;
+	v[0].y = node->y / (double) FRACUNIT - pl->a * size;
+	v[1].x = node->x / (double) FRACUNIT - pl->b * size;
+	v[1].y = node->y / (double) FRACUNIT + pl->a * size;
+
+	for (i = 0; i < numplanes; i++)
+	{
+	    if (!ClipToPlane(v, &planestack[i], 0))
+	    {
+		break;
+	    }
+	}
+
+	if (i == numplanes)
+	{
+	    int f = 0, b = 0;
+
+	    off[0].x = pl->a * PVSOFFSET;
+	    off[0].y = pl->b * PVSOFFSET;
+	    off[1].x = -off[0].x;
+	    off[1].y = -off[0].y;
+
+	    numpieces[0] = numpieces[1] = 0;
+	    SplitPartition(0, node->children[0], v, 0, 1, &off[0]);
+	    SplitPartition(1, node->children[1], v, 0, 1, &off[1]);
+	    qsort(pieces[0], numpieces[0], sizeof(**pieces), ComparePieces);
+	    qsort(pieces[1], numpieces[1], sizeof(**pieces), ComparePieces);
+
+	    // pair up the pieces that overlap
+	    while (f < numpieces[0] && b < numpieces[1])
+	    {
+		const pvspiece_t *const pf = &pieces[0][f], *const pb = &pieces[1][b];
+		const double t0 = MAX(pf->t0, pb->t0);
+		const double t1 = MIN(pf->t1, pb->t1);
+
+		if (t1 > t0 && pf->cell != pb->cell)
+		{
+		    AddPortal(pf->cell, pb->cell, Lerp(v, t0), Lerp(v, t1));
+		}
+
+		if (pf->t1 < pb->t1)
+		    f++;
+		else
+		    b++;
+	    }
+	}
+    }
+
+    for (side = 0; side < 2; side++)
+    {
+	if (node->children[side] & NF_SUBSECTOR)
+	{
+	    continue;
+	}
+
+	planestack[numplanes] = *pl;
+	if (side)
+	{
+	    planestack[numplanes].a = -pl->a;
+	    planestack[numplanes].b = -pl->b;
+	    planestack[numplanes].c = -pl->c;
+	}
+	numplanes++;
+	BuildPortals(node->children[side], size);
+	numplanes--;
+    }
+}
+
+// Cut the target portal down to the part that a straight line coming
+// through the source and then the pass portal can reach. The lines
+// through one end of each that have the two portals on opposite sides
+// bound that region.
+static boolean ClipToSeparators (const pvsvec_t *source, const pvsvec_t *pass,
+                                 pvsvec_t *target)
+{
+    pvsplane_t pl;
+    int i, j;
+
+    // any line through the first portal will do
+    if (pass == source)
+    {
+	return true;
+    }
+
+    // two portals on the same line only leave that line
+    PlaneThrough(&pl, source[0].x, source[0].y,
+                 source[1].x - source[0].x, source[1].y - source[0].y);
+
+    if (fabs(PlaneDist(&pl, &pass[0])) < 1.0 / 16
+        && fabs(PlaneDist(&pl, &pass[1])) < 1.0 / 16)
+    {
+	if (!ClipToPlane(target, &pl, PVSSLOP))
+	{
+	    return false;
+	}
+
+	pl.a = -pl.a;
+	pl.b = -pl.b;
+	pl.c = -pl.c;
+
+	return ClipToPlane(target, &pl, PVSSLOP);
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+	for (j = 0; j < 2; j++)
+	{
+	    double ds, dp;
+
+	    PlaneThrough(&pl, source[i].x, source[i].y,
+	                 pass[j].x - source[i].x, pass[j].y - source[i].y);
+
+	    if (pl.a == 0 && pl.b == 0)
+	    {
+		continue;
+	    }
+
+	    ds = PlaneDist(&pl, &source[i ^ 1]);
+	    dp = PlaneDist(&pl, &pass[j ^ 1]);
+
+	    if (ds > 0 && dp < 0)
+	    {
+		pl.a = -pl.a;
+		pl.b = -pl.b;
+		pl.c = -pl.c;
+	    }
+	    else if (!(ds < 0 && dp > 0))
+	    {
+		continue;
+	    }
+
+	    if (!ClipToPlane(target, &pl, 1.0 / 16))
+	    {
+		return false;
+	    }
+	}
+    }
+
+    return true;
+}
+
+static void MarkCell (int cell)
+{
+    const sector_t *const sector = subsectors[cell].sector;
+
+    if (sector != NULL)
+    {
+	const int s = sector - sectors;
+
+	visrow[s >> 3] |= 1 << (s & 7);
+    }
+}
+
+static void FloodPortals (int cell, const pvsvec_t *source, const pvsvec_t *pass)
+{
+    int i;
+
+    if (++floodsteps > PVSBUDGET)
+    {
+	return;
+    }
+
+    MarkCell(cell);
+    onpath[cell] = true;
+
+    for (i = cellfirst[cell]; i < cellfirst[cell + 1]; i++)
+    {
+	const pvsportal_t *const portal = &portals[cellportals[i]];
+	const int next = portal->cell[portal->cell[0] == cell ? 1 : 0];
+	pvsvec_t target[2];
+
+	if (onpath[next])
+	{
+	    continue;
+	}
+
+	target[0] = portal->v[0];
+	target[1] = portal->v[1];
+
+	if (ClipToSeparators(source, pass, target))
+	{
+	    FloodPortals(next, source, target);
+	}
+    }
+
+    onpath[cell] = false;
+}
+
+// All sectors connected to the subsector through portals at all.
+static void FloodConnected (int cell)
+{
+    int head = 0, tail = 0;
+    int i;
+
+    memset(onpath, 0, numsubsectors);
+    floodqueue[tail++] = cell;
+    onpath[cell] = true;
+
+    while (head < tail)
+    {
+	cell = floodqueue[head++];
+	MarkCell(cell);
+
+	for (i = cellfirst[cell]; i < cellfirst[cell + 1]; i++)
+	{
+	    const pvsportal_t *const portal = &portals[cellportals[i]];
+	    const int next = portal->cell[portal->cell[0] == cell ? 1 : 0];
+
+	    if (!onpath[next])
+	    {
+		onpath[next] = true;
+		floodqueue[tail++] = next;
+	    }
+	}
+    }
+
+    memset(onpath, 0, numsubsectors);
+}
+
+static void ComputeSightPVS (void)
+{
+    const int rowsize = (numsectors + 7) / 8;
+    double minx, miny, maxx, maxy, size;
+    int i, j;
+
+    nodeplanes = I_Realloc(NULL, numnodes * sizeof(*nodeplanes));
+    segplanes = I_Realloc(NULL, numsegs * sizeof(*segplanes));
+    planestack = I_Realloc(NULL, (numnodes + 4) * sizeof(*planestack));
+
+    for (i = 0; i < numnodes; i++)
+    {
+	PlaneThrough(&nodeplanes[i], nodes[i].x / (double) FRACUNIT,
+	             nodes[i].y / (double) FRACUNIT,
+	             nodes[i].dx / (double) FRACUNIT,
+	             nodes[i].dy / (double) FRACUNIT);
+    }
+
+    for (i = 0; i < numsegs; i++)
+    {
+	const vertex_t *const v1 = segs[i].v1, *const v2 = segs[i].v2;
+
+	PlaneThrough(&segplanes[i], v1->x / (double) FRACUNIT,
+	             v1->y / (double) FRACUNIT,
+	             (v2->x - v1->x) / (double) FRACUNIT,
+	             (v2->y - v1->y) / (double) FRACUNIT);
+    }
+
+    // the partitions of the head node are bounded by the map
+    minx = miny = 32767;
+    maxx = maxy = -32768;
+    for (i = 0; i < numvertexes; i++)
+    {
+	minx = MIN(minx, vertexes[i].x / (double) FRACUNIT);
+	miny = MIN(miny, vertexes[i].y / (double) FRACUNIT);
+	maxx = MAX(maxx, vertexes[i].x / (double) FRACUNIT);
+	maxy = MAX(maxy, vertexes[i].y / (double) FRACUNIT);
+    }
+    minx -= 64; miny -= 64;
+    maxx += 64; maxy += 64;
+    size = 2 * (maxx - minx + maxy - miny);
+
+    numplanes = 0;
+    PlaneThrough(&planestack[numplanes++], minx, miny, 0, 1);
+    PlaneThrough(&planestack[numplanes++], minx, maxy, 1, 0);
+    PlaneThrough(&planestack[numplanes++], maxx, maxy, 0, -1);
+    PlaneThrough(&planestack[numplanes++], maxx, miny, -1, 0);
+
+    numportals = 0;
+    BuildPortals(numnodes - 1, size);
+
+    // list the portals of each subsector
+    cellfirst = I_Realloc(NULL, (numsubsectors + 1) * sizeof(*cellfirst));
+    cellportals = I_Realloc(NULL, (2 * numportals + 1) * sizeof(*cellportals));
+    memset(cellfirst, 0, (numsubsectors + 1) * sizeof(*cellfirst));
+
+    floodqueue = I_Realloc(NULL, numsubsectors * sizeof(*floodqueue));
+
+    for (i = 0; i < numportals; i++)
+    {
+	cellfirst[portals[i].cell[0] + 1]++;
+	cellfirst[portals[i].cell[1] + 1]++;
+    }
+    for (i = 0; i < numsubsectors; i++)
+    {
+	cellfirst[i + 1] += cellfirst[i];
+	floodqueue[i] = cellfirst[i];
+    }
+    for (i = 0; i < numportals; i++)
+    {
+	for (j = 0; j < 2; j++)
+	{
+	    cellportals[floodqueue[portals[i].cell[j]]++] = i;
+	}
+    }
+
+    visible = I_Realloc(NULL, numsectors * rowsize);
+    memset(visible, 0, numsectors * rowsize);
+    visrow = I_Realloc(NULL, rowsize);
+    onpath = I_Realloc(NULL, numsubsectors);
+    memset(onpath, 0, numsubsectors);
+
+    for (i = 0; i < numsubsectors; i++)
+    {
+	const sector_t *const sector = subsectors[i].sector;
+	byte *row;
+
+	if (sector == NULL)
+	{
+	    continue;
+	}
+
+	memset(visrow, 0, rowsize);
+	floodsteps = 0;
+
+	MarkCell(i);
+	onpath[i] = true;
+
+	for (j = cellfirst[i]; j < cellfirst[i + 1]; j++)
+	{
+	    const pvsportal_t *const portal = &portals[cellportals[j]];
+	    const int next = portal->cell[portal->cell[0] == i ? 1 : 0];
+
+	    FloodPortals(next, portal->v, portal->v);
+	}
+
+	onpath[i] = false;
+
+	if (floodsteps > PVSBUDGET)
+	{
+	    FloodConnected(i);
+	}
+
+	row = visible + (sector - sectors) * rowsize;
+	for (j = 0; j < rowsize; j++)
+	{
+	    row[j] |= visrow[j];
+	}
+    }
+
+    free(nodeplanes);
+    free(segplanes);
+    free(planestack);
+    free(portals);
+    free(pieces[0]);
+    free(pieces[1]);
+    free(cellfirst);
+    free(cellportals);
+    free(visrow);
+    free(onpath);
+    free(floodqueue);
+    portals = NULL;
+    pieces[0] = pieces[1] = NULL;
+    maxportals = maxpieces[0] = maxpieces[1] = 0;
+}
+
+// The cached table of a map goes by a hash of its geometry.
+static char *CacheFileName (int lumpnum)
+{
+    static const int maplumps[] = {
+	ML_LINEDEFS, ML_SIDEDEFS, ML_VERTEXES,
+	ML_SEGS, ML_SSECTORS, ML_NODES, ML_SECTORS,
+    };
+    sha1_context_t sha1;
+    sha1_digest_t digest;
+    char hex[2 * sizeof(digest) + 1];
+    char *dir, *filename;
+    int i;
+
+    SHA1_Init(&sha1);
+    SHA1_UpdateInt32(&sha1, PVSVERSION);
+
+    for (i = 0; i < arrlen(maplumps); i++)
+    {
+	const int lump = lumpnum + maplumps[i];
+
+	SHA1_UpdateInt32(&sha1, W_LumpLength(lump));
+	SHA1_Update(&sha1, W_CacheLumpNum(lump, PU_STATIC), W_LumpLength(lump));
+	W_ReleaseLumpNum(lump);
+    }
+
+    SHA1_Final(digest, &sha1);
+
+    for (i = 0; i < sizeof(digest); i++)
+    {
+	M_snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    }
+
+    dir = M_StringJoin(configdir, "pvs", NULL);
+    M_MakeDirectory(dir);
+    filename = M_StringJoin(dir, DIR_SEPARATOR_S, hex, ".pvs", NULL);
+    free(dir);
+
+    return filename;
+}
+
+static const byte pvsmagic[4] = {'P', 'V', 'S', PVSVERSION};
+
+static boolean ReadCacheFile (const char *filename, byte *table, int len)
+{
+    byte header[8];
+    FILE *file;
+    boolean result;
+
+    file = fopen(filename, "rb");
+
+    if (file == NULL)
+    {
+	return false;
+    }
+
+    result = fread(header, 1, sizeof(header), file) == sizeof(header)
+          && !memcmp(header, pvsmagic, sizeof(pvsmagic))
+          && (int) (header[4] | (header[5] << 8) | (header[6] << 16)
+                    | ((unsigned int) header[7] << 24)) == numsectors
+          && fread(table, 1, len, file) == len;
+
+    fclose(file);
+
+    return result;
+}
+
+static void WriteCacheFile (const char *filename, const byte *table, int len)
+{
+    byte header[8];
+    FILE *file;
+
+    file = fopen(filename, "wb");
+
+    if (file == NULL)
+    {
+	return;
+    }
+
+    memcpy(header, pvsmagic, sizeof(pvsmagic));
+    header[4] = numsectors & 0xff;
+    header[5] = (numsectors >> 8) & 0xff;
+    header[6] = (numsectors >> 16) & 0xff;
+    header[7] = (numsectors >> 24) & 0xff;
+
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)
+        || fwrite(table, 1, len, file) != len)
+    {
+	fprintf(stderr, "P_BuildSightPVS: Could not write %s\n", filename);
+    }
+
+    fclose(file);
+}
+
+void P_BuildSightPVS (int lumpnum)
+{
+    const int rowsize = (numsectors + 7) / 8;
+    const int len = (numsectors * numsectors + 7) / 8;
+    char *filename;
+    int starttime;
+    int i, j;
+
+    //!
+    // @category game
+    //
+    // For maps with an empty REJECT lump, compute which sectors can't
+    // possibly see each other, so that sight checks between them can be
+    // skipped. The results are cached in the "pvs" subdirectory of the
+    // configuration directory. Sight through map geometry that vanilla's
+    // sight check gets wrong may differ, so the table is not used in
+    // netgames or while recording or playing back demos.
+    //
+
+    if (!M_ParmExists("-sightpvs") || numnodes == 0 || numsectors == 0)
+    {
+	return;
+    }
+
+    sightpvs = Z_Malloc(len, PU_LEVEL, &sightpvs);
+    filename = CacheFileName(lumpnum);
+
+    if (ReadCacheFile(filename, sightpvs, len))
+    {
+	free(filename);
+	return;
+    }
+
+    starttime = I_GetTimeMS();
+    ComputeSightPVS();
+
+    // like REJECT, a set bit means that two sectors can't see each other
+    memset(sightpvs, 0, len);
+    for (i = 0; i < numsectors; i++)
+    {
+	for (j = 0; j < numsectors; j++)
+	{
+	    if (!(visible[i * rowsize + (j >> 3)] & (1 << (j & 7)))
+	        && !(visible[j * rowsize + (i >> 3)] & (1 << (i & 7))))
+	    {
+		const int pnum = i * numsectors + j;
+
+		sightpvs[pnum >> 3] |= 1 << (pnum & 7);
+	    }
+	}
+    }
+
+    free(visible);
+
+    fprintf(stderr, "P_BuildSightPVS: %d sectors in %d ms\n",
+            numsectors, I_GetTimeMS() - starttime);
+
+    WriteCacheFile(filename, sightpvs, len);
+    free(filename);
+}
+
+boolean P_InsideSightPVS (mobj_t *mo)
+{
+    const subsector_t *const sub = mo->subsector;
+    const pvsvec_t v = {mo->x / (double) FRACUNIT, mo->y / (double) FRACUNIT};
+    int i;
+
+    // outside the map, e.g. with noclip, sight could go anywhere
+    for (i = sub->firstline; i < sub->firstline + sub->numlines; i++)
+    {
+	const vertex_t *const v1 = segs[i].v1, *const v2 = segs[i].v2;
+	pvsplane_t pl;
+
+	PlaneThrough(&pl, v1->x / (double) FRACUNIT, v1->y / (double) FRACUNIT,
+	             (v2->x - v1->x) / (double) FRACUNIT,
+	             (v2->y - v1->y) / (double) FRACUNIT);
+
+	if (PlaneDist(&pl, &v) < -PVSSLOP)
+	{
+	    return false;
+	}
+    }
+
+    return true;
+}
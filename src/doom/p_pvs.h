@@ -0,0 +1,36 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[crispy] Sector visibility table for maps without a REJECT lump
+//
+
+#ifndef __P_PVS__
+#define __P_PVS__
+
+#include "doomtype.h"
+#include "p_mobj.h"
+
+// Laid out like the REJECT table, a set bit means that no line of sight
+// between the two sectors is possible. NULL if not in use.
+extern byte *sightpvs;
+
+// Build the table for the level just loaded, or read it from the cache.
+// Called after the REJECT lump has been found to be empty.
+void P_BuildSightPVS (int lumpnum);
+
+// The table only holds for things inside the walls of their subsector.
+boolean P_InsideSightPVS (mobj_t *mo);
+
+#endif
@@ -44,6 +44,7 @@
 #include "doomstat.h"
 
 #include "p_extnodes.h" // [crispy] support extended node formats
+#include "p_pvs.h" // [crispy] P_BuildSightPVS()
 
 void	P_SpawnMapThing (mapthing_t*	mthing);
 
@@ -1001,10 +1002,12 @@ static void PadRejectArray(byte *array, unsigned int len)
     }
 }
 
-static void P_LoadReject(int lumpnum)
+// [crispy] returns true if the REJECT lump doesn't reject anything
+static boolean P_LoadReject(int lumpnum)
 {
     int minlength;
     int lumplen;
+    int i;
 
     // Calculate the size that the REJECT lump *should* be.
 
@@ -1027,6 +1030,16 @@ static void P_LoadReject(int lumpnum)
 
         PadRejectArray(rejectmatrix + lumplen, minlength - lumplen);
     }
+
+    for (i = 0; i < lumplen && i < minlength; i++)
+    {
+        if (rejectmatrix[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 // [crispy] log game skill in plain text
@@ -1161,6 +1174,7 @@ P_SetupLevel
     musinfo.from_savegame = false;
 
     Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+    P_ResetThinkerPools (); // [crispy] their slabs have just been freed
 
     // UNUSED W_Profile ();
     P_InitThinkers ();
@@ -1254,7 +1268,11 @@ P_SetupLevel
     }
 
     P_GroupLines ();
-    P_LoadReject (lumpnum+ML_REJECT);
+    // [crispy] compute a table for maps without REJECT
+    if (P_LoadReject (lumpnum+ML_REJECT))
+    {
+	P_BuildSightPVS (lumpnum);
+    }
 
     // [crispy] remove slime trails
     P_RemoveSlimeTrails();
@@ -1314,6 +1332,7 @@ void P_Init (void)
     P_InitSwitchList ();
     P_InitPicAnims ();
     R_InitSprites (sprnames);
+    P_InitSightCache (); // [crispy]
 }
 
 
@@ -17,11 +17,15 @@
 //
 
 
+#include <string.h> // [crispy] memset()
+
 #include "doomdef.h"
 #include "doomstat.h"
 
 #include "i_system.h"
+#include "m_argv.h" // [crispy] M_ParmExists()
 #include "p_local.h"
+#include "p_pvs.h" // [crispy] sightpvs
 
 // State.
 #include "r_state.h"
@@ -39,6 +43,63 @@ fixed_t		t2y;
 
 int		sightcounts[2];
 
+// [crispy] memoised sight checks
+// Monsters often check sight to the same target more than once in a tic,
+// e.g. in A_Chase() and then P_CheckMissileRange(). The result of the BSP
+// traversal only depends on the exact eye and target positions and on the
+// sector heights, so it is kept in a small direct mapped table, keyed on
+// the positions. Entries are only valid in the generation they were made
+// in, which ends with the tic and with any change of a sector height.
+
+#define SIGHTCACHESIZE 1024 // must be a power of two
+
+typedef struct
+{
+    fixed_t t1x, t1y, t1z;  // eye of the looker
+    fixed_t t2x, t2y, t2z, t2height;
+    unsigned int generation;
+    boolean result;
+} sightentry_t;
+
+sightcache_t sightcache;
+
+static sightentry_t *sightentries;
+static unsigned int sightgeneration = 1;
+
+void P_InitSightCache (void)
+{
+    //!
+    // @category obscure
+    //
+    // Don't memoise sight checks within a tic.
+    //
+
+    if (M_ParmExists("-nosightcache"))
+    {
+	return;
+    }
+
+    sightentries = I_Realloc(NULL, SIGHTCACHESIZE * sizeof(*sightentries));
+    memset(sightentries, 0, SIGHTCACHESIZE * sizeof(*sightentries));
+}
+
+void P_InvalidateSightCache (void)
+{
+    sightgeneration++;
+}
+
+static sightentry_t *P_SightCacheEntry (mobj_t *t1, mobj_t *t2)
+{
+    unsigned int hash;
+
+    hash = (unsigned int) t1->x * 31 + (unsigned int) t1->y;
+    hash = hash * 31 + (unsigned int) t2->x;
+    hash = hash * 31 + (unsigned int) t2->y;
+    hash ^= hash >> 16;
+
+    return &sightentries[(hash ^ (hash >> 8)) & (SIGHTCACHESIZE - 1)];
+}
+
 
 // PTR_SightTraverse() for Doom 1.2 sight calculations
 // taken from prboom-plus/src/p_sight.c:69-102
@@ -345,6 +406,8 @@ P_CheckSight
     int		pnum;
     int		bytenum;
     int		bitnum;
+    sightentry_t *entry = NULL; // [crispy]
+    boolean	result;
     
     // First check for trivial rejection.
 
@@ -364,6 +427,15 @@ P_CheckSight
 	return false;	
     }
 
+    // [crispy] check in the table computed for maps without REJECT,
+    // which may reject pairs vanilla can see, so single player only
+    if (crispy->singleplayer && sightpvs != NULL && (sightpvs[bytenum]&bitnum)
+        && P_InsideSightPVS(t1) && P_InsideSightPVS(t2))
+    {
+	sightcounts[0]++;
+	return false;
+    }
+
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
     sightcounts[1]++;
@@ -380,6 +452,24 @@ P_CheckSight
                               PT_EARLYOUT | PT_ADDLINES, PTR_SightTraverse);
     }
 
+    // [crispy] memoised sight checks
+    if (sightentries != NULL)
+    {
+	entry = P_SightCacheEntry(t1, t2);
+
+	if (entry->generation == sightgeneration
+	    && entry->t1x == t1->x && entry->t1y == t1->y
+	    && entry->t1z == sightzstart
+	    && entry->t2x == t2->x && entry->t2y == t2->y
+	    && entry->t2z == t2->z && entry->t2height == t2->height)
+	{
+	    sightcache.hits++;
+	    return entry->result;
+	}
+
+	sightcache.misses++;
+    }
+
     strace.x = t1->x;
     strace.y = t1->y;
     t2x = t2->x;
@@ -388,7 +478,22 @@ P_CheckSight
     strace.dy = t2->y - t1->y;
 
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+    result = P_CrossBSPNode (numnodes-1);
+
+    if (entry != NULL)
+    {
+	entry->t1x = t1->x;
+	entry->t1y = t1->y;
+	entry->t1z = sightzstart;
+	entry->t2x = t2->x;
+	entry->t2y = t2->y;
+	entry->t2z = t2->z;
+	entry->t2height = t2->height;
+	entry->generation = sightgeneration;
+	entry->result = result;
+    }
+
+    return result;
 }
 
 
@@ -29,7 +29,7 @@ int	leveltime;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by P_AllocThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -89,6 +89,123 @@ void P_AllocateThinker (thinker_t*	thinker)
 
 
 
+//
+// [crispy] thinker pools
+// Thinkers are allocated and freed all the time, projectiles and their
+// puffs and blood in particular. Rather than going through the zone for
+// each of them, they are taken from slabs of equally sized nodes, one
+// free list per type. The slabs are PU_LEVEL zone blocks, so they are all
+// released together at the end of the level.
+//
+
+#define POOLSLAB 64 // nodes per slab
+
+// Each thinker is preceded by a header that tells which pool it is from,
+// or links it into the free list while it is unused.
+typedef union poolnode_u
+{
+    union poolnode_u *next;
+    thinkerpool_t pool;
+    int64_t align;
+} poolnode_t;
+
+typedef struct
+{
+    size_t size;       // size of the thinker, without the header
+    poolnode_t *free;  // unused nodes
+} pool_t;
+
+static pool_t pools[NUMTHINKERPOOLS] = {
+    {sizeof(mobj_t)},
+    {sizeof(ceiling_t)},
+    {sizeof(vldoor_t)},
+    {sizeof(floormove_t)},
+    {sizeof(plat_t)},
+    {sizeof(fireflicker_t)},
+    {sizeof(lightflash_t)},
+    {sizeof(strobe_t)},
+    {sizeof(glow_t)},
+};
+
+thinkerpoolstats_t thinkerpools[NUMTHINKERPOOLS] = {
+    {"mobjs"},
+    {"ceilings"},
+    {"doors"},
+    {"floors"},
+    {"plats"},
+    {"fireflickers"},
+    {"lightflashes"},
+    {"strobes"},
+    {"glows"},
+};
+
+static void P_GrowThinkerPool (pool_t *pool)
+{
+    size_t stride;
+    byte *slab;
+    int i;
+
+    stride = sizeof(poolnode_t)
+           + (pool->size + sizeof(poolnode_t) - 1) / sizeof(poolnode_t) * sizeof(poolnode_t);
+    slab = Z_Malloc(POOLSLAB * stride, PU_LEVEL, NULL);
+
+    // hand the nodes out in ascending order
+    for (i = POOLSLAB - 1; i >= 0; i--)
+    {
+	poolnode_t *const node = (poolnode_t *) (slab + i * stride);
+
+	node->next = pool->free;
+	pool->free = node;
+    }
+}
+
+void *P_AllocThinker (thinkerpool_t type)
+{
+    pool_t *const pool = &pools[type];
+    thinkerpoolstats_t *const stats = &thinkerpools[type];
+    poolnode_t *node;
+
+    if (pool->free == NULL)
+    {
+	P_GrowThinkerPool(pool);
+    }
+
+    node = pool->free;
+    pool->free = node->next;
+    node->pool = type;
+
+    if (++stats->live > stats->peak)
+    {
+	stats->peak = stats->live;
+    }
+
+    return node + 1;
+}
+
+void P_FreeThinker (thinker_t* thinker)
+{
+    poolnode_t *const node = (poolnode_t *) thinker - 1;
+    const thinkerpool_t type = node->pool;
+
+    thinkerpools[type].live--;
+
+    node->next = pools[type].free;
+    pools[type].free = node;
+}
+
+void P_ResetThinkerPools (void)
+{
+    int i;
+
+    for (i = 0; i < NUMTHINKERPOOLS; i++)
+    {
+	pools[i].free = NULL;
+	thinkerpools[i].live = 0;
+    }
+}
+
+
+
 //
 // P_RunThinkers
 //
@@ -105,7 +222,7 @@ void P_RunThinkers (void)
             nextthinker = currentthinker->next;
 	    currentthinker->next->prev = currentthinker->prev;
 	    currentthinker->prev->next = currentthinker->next;
-	    Z_Free(currentthinker);
+	    P_FreeThinker(currentthinker); // [crispy] thinker pools
 	}
 	else
 	{
@@ -144,6 +261,9 @@ void P_Ticker (void)
     }
     
 		
+    // [crispy] sight checks are only memoised within a tic
+    P_InvalidateSightCache ();
+
     for (i=0 ; i<MAXPLAYERS ; i++)
 	if (playeringame[i])
 	    P_PlayerThink (&players[i]);
@@ -26,7 +26,7 @@
 
 // [crispy] brightmap data
 
-static byte nobrightmap[256] = {0};
+byte nobrightmap[256] = {0};
 
 static byte notgray[256] =
 {
@@ -314,7 +314,7 @@ static byte hacxlightning[256] =
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 };
 
-byte *dc_brightmap = nobrightmap;
+THREADLOCAL byte *dc_brightmap = nobrightmap;
 
 // [crispy] brightmaps for textures
 
@@ -30,5 +30,10 @@ extern byte *(*R_BrightmapForFlatNum) (const int num);
 extern byte *(*R_BrightmapForState) (const int state);
 
 extern byte **texturebrightmap;
+extern byte nobrightmap[256];
+
+// [crispy] true if the brightmap changes the current column, i.e. if it
+// has to be drawn with brightcolfunc instead of the plain basecolfunc
+#define R_BRIGHTMAPPED (dc_brightmap != nobrightmap && dc_colormap[1] != dc_colormap[0])
 
 #endif
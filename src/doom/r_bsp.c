@@ -27,6 +27,7 @@
 
 #include "r_main.h"
 #include "r_plane.h"
+#include "r_segs.h"
 #include "r_things.h"
 
 // State.
@@ -37,15 +38,15 @@
 
 
 
-seg_t*		curline;
-side_t*		sidedef;
-line_t*		linedef;
-sector_t*	frontsector;
-sector_t*	backsector;
+THREADLOCAL seg_t*		curline;
+THREADLOCAL side_t*		sidedef;
+THREADLOCAL line_t*		linedef;
+THREADLOCAL sector_t*	frontsector;
+THREADLOCAL sector_t*	backsector;
 
-drawseg_t*	drawsegs = NULL;
-drawseg_t*	ds_p;
-int		numdrawsegs = 0;
+THREADLOCAL drawseg_t*	drawsegs = NULL;
+THREADLOCAL drawseg_t*	ds_p;
+THREADLOCAL int		numdrawsegs = 0;
 
 
 void
@@ -71,117 +72,201 @@ void R_ClearDrawSegs (void)
 // Clips the given range of columns
 // and includes it in the new clip list.
 //
-typedef	struct
-{
-    int	first;
-    int last;
-    
-} cliprange_t;
+// [crispy] The columns that are already covered by solid walls are kept
+// in a bitset instead of Doom's sorted list of ranges, which fragments
+// badly on detailed maps in high resolution. One bit per column, and one
+// bit per word of columns that are all covered, so that finding the next
+// open column or checking a whole range takes a few word operations.
+//
+#define COVERBITS 64
+#define COVERWORDS ((MAXWIDTH + COVERBITS - 1) / COVERBITS)
 
-// We must expand MAXSEGS to the theoretical limit of the number of solidsegs
-// that can be generated in a scene by the DOOM engine. This was determined by
-// Lee Killough during BOOM development to be a function of the screensize.
-// The simplest thing we can do, other than fix this bug, is to let the game
-// render overage and then bomb out by detecting the overflow after the 
-// fact. -haleyjd
-//#define MAXSEGS 32
-#define MAXSEGS (MAXWIDTH / 2 + 1)
+#if COVERWORDS > 32
+#error "The coverage summary does not fit into 32 bits"
+#endif
 
-// newend is one past the last valid seg
-cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+THREADLOCAL uint64_t	coverage[COVERWORDS];
+THREADLOCAL uint32_t	fullwords; // bit n set when coverage[n] is full
 
+// bits lo to hi of a word, both inclusive
+static inline uint64_t CoverMask (int lo, int hi)
+{
+    return (~(uint64_t) 0 >> (COVERBITS - 1 - hi)) & (~(uint64_t) 0 << lo);
+}
 
+// index of the lowest set bit, which must exist
+static inline int LowestBit (uint64_t bits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int n = 0;
 
+    while (!(bits & 1))
+    {
+	bits >>= 1;
+	n++;
+    }
+
+    return n;
+#endif
+}
 
 //
-// R_ClipSolidWallSegment
-// Does handle solid walls,
-//  e.g. single sided LineDefs (middle texture)
-//  that entirely block the view.
-// 
-void
-R_ClipSolidWallSegment
-( int			first,
-  int			last )
+// R_FirstOpenColumn
+// Returns the first column from x on that is not covered yet,
+// or a value beyond last if there is none up to last.
+//
+static inline int R_FirstOpenColumn (int x, int last)
 {
-    cliprange_t*	next;
-    cliprange_t*	start;
+    int w = x / COVERBITS;
+    uint64_t bits = ~coverage[w] & (~(uint64_t) 0 << (x % COVERBITS));
 
-    // Find the first range that touches the range
-    //  (adjacent pixels are touching).
-    start = solidsegs;
-    while (start->last < first-1)
-	start++;
-
-    if (first < start->first)
+    while (!bits)
     {
-	if (last < start->first-1)
+	// [crispy] skip all full words at once
+	const uint32_t open = ~fullwords & (~(uint32_t) 0 << w << 1);
+
+	if (!open)
 	{
-	    // Post is entirely visible (above start),
-	    //  so insert a new clippost.
-	    R_StoreWallRange (first, last);
-	    next = newend;
-	    newend++;
-	    
-	    while (next != start)
-	    {
-		*next = *(next-1);
-		next--;
-	    }
-	    next->first = first;
-	    next->last = last;
-	    return;
+	    return last + 1;
 	}
-		
-	// There is a fragment above *start.
-	R_StoreWallRange (first, start->first - 1);
-	// Now adjust the clip size.
-	start->first = first;	
+
+	w = LowestBit(open);
+
+	if (w * COVERBITS > last)
+	{
+	    return last + 1;
+	}
+
+	bits = ~coverage[w];
     }
 
-    // Bottom contained in start?
-    if (last <= start->last)
-	return;			
-		
-    next = start;
-    while (last >= (next+1)->first-1)
+    return w * COVERBITS + LowestBit(bits);
+}
+
+//
+// R_FirstCoveredColumn
+// Returns the first column from x on that is covered,
+// or last + 1 if there is none up to last.
+//
+static inline int R_FirstCoveredColumn (int x, int last)
+{
+    int w = x / COVERBITS;
+    const int lastw = last / COVERBITS;
+    uint64_t bits = coverage[w] & (~(uint64_t) 0 << (x % COVERBITS));
+
+    while (!bits)
     {
-	// There is a fragment between two posts.
-	R_StoreWallRange (next->last + 1, (next+1)->first - 1);
-	next++;
-	
-	if (last <= next->last)
+	if (++w > lastw)
 	{
-	    // Bottom is contained in next.
-	    // Adjust the clip size.
-	    start->last = next->last;	
-	    goto crunch;
+	    return last + 1;
 	}
+
+	bits = coverage[w];
     }
-	
-    // There is a fragment after *next.
-    R_StoreWallRange (next->last + 1, last);
-    // Adjust the clip size.
-    start->last = last;
-	
-    // Remove start+1 to next from the clip list,
-    // because start now covers their area.
-  crunch:
-    if (next == start)
+
+    x = w * COVERBITS + LowestBit(bits);
+
+    return x <= last ? x : last + 1;
+}
+
+//
+// R_ColumnsCovered
+// Returns true if all of the columns first to last are covered.
+//
+static boolean R_ColumnsCovered (int first, int last)
+{
+    const int w1 = first / COVERBITS;
+    const int w2 = last / COVERBITS;
+    uint64_t mask;
+
+    if (w1 == w2)
     {
-	// Post just extended past the bottom of one post.
-	return;
+	mask = CoverMask(first % COVERBITS, last % COVERBITS);
+	return (coverage[w1] & mask) == mask;
     }
-    
 
-    while (next++ != newend)
+    mask = CoverMask(first % COVERBITS, COVERBITS - 1);
+    if ((coverage[w1] & mask) != mask)
+    {
+	return false;
+    }
+
+    mask = CoverMask(0, last % COVERBITS);
+    if ((coverage[w2] & mask) != mask)
+    {
+	return false;
+    }
+
+    // [crispy] all the words in between must be full
+    if (w2 - w1 > 1)
+    {
+	const uint32_t between = (~(uint32_t) 0 >> (31 - (w2 - 1))) & (~(uint32_t) 0 << (w1 + 1));
+
+	return (fullwords & between) == between;
+    }
+
+    return true;
+}
+
+//
+// R_CoverColumns
+// Marks the columns first to last as covered.
+//
+static void R_CoverColumns (int first, int last)
+{
+    const int w1 = first / COVERBITS;
+    const int w2 = last / COVERBITS;
+    int w;
+
+    for (w = w1; w <= w2; w++)
+    {
+	const int lo = (w == w1) ? first % COVERBITS : 0;
+	const int hi = (w == w2) ? last % COVERBITS : COVERBITS - 1;
+
+	coverage[w] |= CoverMask(lo, hi);
+
+	if (coverage[w] == ~(uint64_t) 0)
+	{
+	    fullwords |= (uint32_t) 1 << w;
+	}
+    }
+}
+
+//
+// R_StoreOpenRanges
+// Stores every range of columns from first to last that is
+// not covered yet, from left to right.
+//
+static inline void R_StoreOpenRanges (int first, int last)
+{
+    int x = first;
+
+    while ((x = R_FirstOpenColumn(x, last)) <= last)
     {
-	// Remove a post.
-	*++start = *next;
+	const int stop = R_FirstCoveredColumn(x, last);
+
+	R_StoreWallRange (x, stop - 1);
+	x = stop;
     }
+}
+
 
-    newend = start+1;
+
+//
+// R_ClipSolidWallSegment
+// Does handle solid walls,
+//  e.g. single sided LineDefs (middle texture)
+//  that entirely block the view.
+// 
+void
+R_ClipSolidWallSegment
+( int			first,
+  int			last )
+{
+    R_StoreOpenRanges (first, last);
+    R_CoverColumns (first, last);
 }
 
 
@@ -198,43 +283,7 @@ R_ClipPassWallSegment
 ( int	first,
   int	last )
 {
-    cliprange_t*	start;
-
-    // Find the first range that touches the range
-    //  (adjacent pixels are touching).
-    start = solidsegs;
-    while (start->last < first-1)
-	start++;
-
-    if (first < start->first)
-    {
-	if (last < start->first-1)
-	{
-	    // Post is entirely visible (above start).
-	    R_StoreWallRange (first, last);
-	    return;
-	}
-		
-	// There is a fragment above *start.
-	R_StoreWallRange (first, start->first - 1);
-    }
-
-    // Bottom contained in start?
-    if (last <= start->last)
-	return;			
-		
-    while (last >= (start+1)->first-1)
-    {
-	// There is a fragment between two posts.
-	R_StoreWallRange (start->last + 1, (start+1)->first - 1);
-	start++;
-	
-	if (last <= start->last)
-	    return;
-    }
-	
-    // There is a fragment after *next.
-    R_StoreWallRange (start->last + 1, last);
+    R_StoreOpenRanges (first, last);
 }
 
 
@@ -244,16 +293,22 @@ R_ClipPassWallSegment
 //
 void R_ClearClipSegs (void)
 {
-    solidsegs[0].first = -0x7fffffff;
-    solidsegs[0].last = -1;
-    solidsegs[1].first = viewwidth;
-    solidsegs[1].last = 0x7fffffff;
-    newend = solidsegs+2;
+    memset(coverage, 0, sizeof(coverage));
+    fullwords = 0;
 }
 
+// [crispy] set while the render threads are running
+static boolean sectorslocked = false;
+
 // [AM] Interpolate the passed sector, if prudent.
 void R_MaybeInterpolateSector(sector_t* sector)
 {
+    // [crispy] already done up front by R_LockSectors()
+    if (sectorslocked)
+    {
+        return;
+    }
+
     if (crispy->uncapped &&
         // Only if we moved the sector last tic.
         sector->oldgametic == gametic - 1)
@@ -275,6 +330,25 @@ void R_MaybeInterpolateSector(sector_t* sector)
     }
 }
 
+// [crispy] multithreaded rendering: interpolate all sectors and cache
+// their WiggleFix scales up front, so that the render threads only ever
+// read from the sector structures
+void R_LockSectors (boolean lock)
+{
+    int i;
+
+    if (lock)
+    {
+        for (i = 0; i < numsectors; i++)
+        {
+            R_MaybeInterpolateSector(&sectors[i]);
+            R_FixWiggle(&sectors[i]);
+        }
+    }
+
+    sectorslocked = lock;
+}
+
 //
 // R_AddLine
 // Clips the given segment
@@ -424,8 +498,6 @@ boolean R_CheckBBox (fixed_t*	bspcoord)
     angle_t		span;
     angle_t		tspan;
     
-    cliprange_t*	start;
-
     int			sx1;
     int			sx2;
     
@@ -502,18 +574,8 @@ boolean R_CheckBBox (fixed_t*	bspcoord)
 	return false;			
     sx2--;
 	
-    start = solidsegs;
-    while (start->last < sx2)
-	start++;
-    
-    if (sx1 >= start->first
-	&& sx2 <= start->last)
-    {
-	// The clippost contains the new span.
-	return false;
-    }
-
-    return true;
+    // [crispy] the solid walls cover the new span
+    return !R_ColumnsCovered(sx1, sx2);
 }
 
 
@@ -579,10 +641,6 @@ void R_Subsector (int num)
 	R_AddLine (line);
 	line++;
     }
-
-    // check for solidsegs overflow - extremely unsatisfactory!
-    if(newend > &solidsegs[32] && false)
-        I_Error("R_Subsector: solidsegs overflow (vanilla may crash here)\n");
 }
 
 
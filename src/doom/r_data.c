@@ -23,12 +23,15 @@
 #include "deh_main.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
 #include "z_zone.h"
 
 
 #include "w_wad.h"
 
 #include "doomdef.h"
+#include "m_config.h" // [crispy] configdir
 #include "m_misc.h"
 #include "r_local.h"
 #include "p_local.h"
@@ -158,6 +161,13 @@ byte**			texturecomposite; // [crispy] composited translucent mid-textures on 2S
 byte**			texturecomposite2; // [crispy] composited opaque textures
 byte**			texturebrightmap; // [crispy] brightmaps
 
+// [crispy] composite texture cache, see R_TrimCompositeCache()
+compositecache_t	compositecache;
+static int*		compositelastused; // framecount of the last R_GetColumn()
+static int*		compositelist; // textures with a composite
+static int		numcomposites;
+static unsigned int	framemisses;
+
 // for global animation
 int*		flattranslation;
 int*		texturetranslation;
@@ -273,15 +283,26 @@ void R_GenerateComposite (int texnum)
     byte*		marks; // killough 4/9/98: transparency marks
     byte*		source; // killough 4/9/98: temporary column
 	
+    // [crispy] multithreaded rendering: another render thread
+    // may have just generated this texture, so check again
+    R_LockRenderCache();
+
+    if (texturecomposite[texnum] && texturecomposite2[texnum])
+    {
+	R_UnlockRenderCache();
+	return;
+    }
+
     texture = textures[texnum];
 
+    // [crispy] only published once it is complete, see below
     block = Z_Malloc (texturecompositesize[texnum],
 		      PU_STATIC, 
-		      &texturecomposite[texnum]);	
+		      NULL);
     // [crispy] memory block for opaque textures
     block2 = Z_Malloc (texture->width * texture->height,
 		      PU_STATIC,
-		      &texturecomposite2[texnum]);
+		      NULL);
 
     collump = texturecolumnlump[texnum];
     colofs = texturecolumnofs[texnum];
@@ -394,10 +415,21 @@ void R_GenerateComposite (int texnum)
     free(source); // free temporary column
     free(marks); // free transparency marks
 
-    // Now that the texture has been built in column cache,
-    //  it is purgable from zone memory.
-    Z_ChangeTag (block, PU_CACHE);
-    Z_ChangeTag (block2, PU_CACHE);
+    // [crispy] make the texture contents visible to the other
+    // render threads before the pointers to them
+    I_MemoryBarrier();
+    Z_ChangeUser (block, (void **) &texturecomposite[texnum]);
+    Z_ChangeUser (block2, (void **) &texturecomposite2[texnum]);
+
+    // [crispy] the composites are not purgable, but get evicted from
+    // the composite texture cache in R_TrimCompositeCache() instead
+    compositelist[numcomposites++] = texnum;
+    compositelastused[texnum] = framecount;
+    compositecache.bytes += texturecompositesize[texnum] + texture->width * texture->height;
+    compositecache.misses++;
+    framemisses++;
+
+    R_UnlockRenderCache();
 }
 
 
@@ -407,6 +439,18 @@ void R_GenerateComposite (int texnum)
 //
 // Rewritten by Lee Killough for performance and to fix Medusa bug
 //
+// [crispy] may run in a load thread, so all zone memory access is
+// serialized and the cache must not be purged meanwhile. Problems are
+// recorded in lookupstatus[] and reported by R_ReportLookups().
+//
+
+typedef struct
+{
+    int pnglump; // patch in PNG format, or -1
+    boolean nopatchcolumn;
+} lookupstatus_t;
+
+static lookupstatus_t *lookupstatus;
 
 void R_GenerateLookup (int texnum)
 {
@@ -434,13 +478,18 @@ void R_GenerateLookup (int texnum)
     collump = texturecolumnlump[texnum];
     colofs = texturecolumnofs[texnum];
     colofs2 = texturecolumnofs2[texnum];
+
+    lookupstatus[texnum].pnglump = -1;
+    lookupstatus[texnum].nopatchcolumn = false;
     
     // Now count the number of columns
     //  that are covered by more than one patch.
     // Fill in the lump / offset, so columns
     //  with only a single patch are all done.
+    R_LockRenderCache();
     patchcount = (byte *) Z_Malloc(texture->width, PU_STATIC, &patchcount);
     postcount = (byte *) Z_Malloc(texture->width, PU_STATIC, &postcount);
+    R_UnlockRenderCache();
     memset (patchcount, 0, texture->width);
     memset (postcount, 0, texture->width);
 
@@ -448,7 +497,9 @@ void R_GenerateLookup (int texnum)
 	 i<texture->patchcount;
 	 i++, patch++)
     {
+	R_LockRenderCache();
 	realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+	R_UnlockRenderCache();
 	x1 = patch->originx;
 	x2 = x1 + SHORT(realpatch->width);
 
@@ -459,7 +510,12 @@ void R_GenerateLookup (int texnum)
 		if (magic[0] == 0x89 &&
 		    magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G')
 		{
-			I_Error("Patch in PNG format detected: %.8s", lumpinfo[patch->patch]->name);
+			lookupstatus[texnum].pnglump = patch->patch;
+			R_LockRenderCache();
+			Z_Free(patchcount);
+			Z_Free(postcount);
+			R_UnlockRenderCache();
+			return;
 		}
 	}
 	
@@ -499,9 +555,17 @@ void R_GenerateLookup (int texnum)
 	for (i = texture->patchcount, patch = texture->patches; --i >= 0; )
 	{
 	    int pat = patch->patch;
-	    const patch_t *realpatch = W_CacheLumpNum(pat, PU_CACHE);
-	    int x, x1 = patch++->originx, x2 = x1 + SHORT(realpatch->width);
-	    const int *cofs = realpatch->columnofs - x1;
+	    const patch_t *realpatch;
+	    int x, x1, x2;
+	    const int *cofs;
+
+	    R_LockRenderCache();
+	    realpatch = W_CacheLumpNum(pat, PU_CACHE);
+	    R_UnlockRenderCache();
+
+	    x1 = patch++->originx;
+	    x2 = x1 + SHORT(realpatch->width);
+	    cofs = realpatch->columnofs - x1;
 
 	    if (x2 > texture->width)
 		x2 = texture->width;
@@ -538,9 +602,8 @@ void R_GenerateLookup (int texnum)
     {
 	if (!patchcount[x] && !err++) // killough 10/98: non-verbose output
 	{
-	    // [crispy] fix absurd texture name in error message
-	    printf ("R_GenerateLookup: column without a patch (%.8s)\n",
-		    texture->name);
+	    // [crispy] reported by R_ReportLookups()
+	    lookupstatus[texnum].nopatchcolumn = true;
 	    // [crispy] do not return yet
 	    /*
 	    return;
@@ -584,8 +647,82 @@ void R_GenerateLookup (int texnum)
 
     texturecompositesize[texnum] = csize;
 
+    R_LockRenderCache();
     Z_Free(patchcount);
     Z_Free(postcount);
+    R_UnlockRenderCache();
+}
+
+// [crispy] number of threads that set up the texture and sprite tables
+int numloadthreads = 1;
+
+// [crispy] every load job handles this many consecutive entries
+#define LOADBATCH 64
+
+static void R_GenerateLookupJob (int index, void *unused)
+{
+    const int last = MIN((index + 1) * LOADBATCH, numtextures);
+    int i;
+
+    for (i = index * LOADBATCH; i < last; i++)
+    {
+	R_GenerateLookup (i);
+    }
+}
+
+//
+// R_ReportLookups
+// [crispy] report what went wrong in R_GenerateLookup() from the main
+// thread, in texture order
+//
+static void R_ReportLookups (void)
+{
+    int i;
+
+    for (i = 0; i < numtextures; i++)
+    {
+	if (lookupstatus[i].pnglump >= 0)
+	{
+	    I_Error("Patch in PNG format detected: %.8s",
+	            lumpinfo[lookupstatus[i].pnglump]->name);
+	}
+
+	if (lookupstatus[i].nopatchcolumn)
+	{
+	    // [crispy] fix absurd texture name in error message
+	    printf ("R_GenerateLookup: column without a patch (%.8s)\n",
+		    textures[i]->name);
+	}
+    }
+
+    free(lookupstatus);
+    lookupstatus = NULL;
+}
+
+//
+// R_RunLoadJobs
+// [crispy] run a load job for every batch of count entries, on the
+// worker threads if there are any. Each entry is written by exactly one
+// job, so the result does not depend on the number of threads.
+//
+static void R_RunLoadJobs (int count, i_threadjob_t job)
+{
+    const int numjobs = (count + LOADBATCH - 1) / LOADBATCH;
+    int i;
+
+    if (numloadthreads > 1)
+    {
+	Z_SuspendPurge(true);
+	I_RunThreadJobs(numjobs, numloadthreads, job, NULL);
+	Z_SuspendPurge(false);
+    }
+    else
+    {
+	for (i = 0; i < numjobs; i++)
+	{
+	    job(i, NULL);
+	}
+    }
 }
 
 
@@ -604,6 +741,9 @@ R_GetColumn
     col &= texturewidthmask[tex];
     ofs = texturecolumnofs2[tex][col];
 
+    // [crispy] keeps the composite from being evicted in this frame
+    compositelastused[tex] = framecount;
+
     if (!texturecomposite2[tex])
 	R_GenerateComposite (tex);
 
@@ -624,12 +764,70 @@ R_GetColumnMod
     col %= texturewidth[tex];
     ofs = texturecolumnofs[tex][col];
 
+    compositelastused[tex] = framecount;
+
     if (!texturecomposite[tex])
 	R_GenerateComposite (tex);
 
     return texturecomposite[tex] + ofs;
 }
 
+static int CompareLastUsed (const void *a, const void *b)
+{
+    return compositelastused[*(const int *) a] - compositelastused[*(const int *) b];
+}
+
+//
+// R_TrimCompositeCache
+// [crispy] called between two frames, when no render thread is running.
+// Frees the least recently used composites until the cache fits into
+// its budget again, but never the ones drawn in the last frame, so that
+// no texture has to be composited twice within the same frame.
+//
+void R_TrimCompositeCache (void)
+{
+    int i, used;
+
+    // [crispy] every texture drawn in the last frame that did not have
+    // to be composited for it was found in the cache
+    for (i = 0, used = 0; i < numcomposites; i++)
+    {
+	if (compositelastused[compositelist[i]] == framecount)
+	{
+	    used++;
+	}
+    }
+
+    compositecache.hits += MAX(used - (int) framemisses, 0);
+    framemisses = 0;
+
+    if (compositecache.budget <= 0 || compositecache.bytes <= compositecache.budget)
+    {
+	return;
+    }
+
+    qsort(compositelist, numcomposites, sizeof(*compositelist), CompareLastUsed);
+
+    for (i = 0; i < numcomposites && compositecache.bytes > compositecache.budget; i++)
+    {
+	const int tex = compositelist[i];
+
+	if (compositelastused[tex] == framecount)
+	{
+	    break;
+	}
+
+	compositecache.bytes -= texturecompositesize[tex] + textures[tex]->width * textures[tex]->height;
+	compositecache.evictions++;
+
+	// [crispy] Z_Free() resets the pointers
+	Z_Free(texturecomposite[tex]);
+	Z_Free(texturecomposite2[tex]);
+    }
+
+    numcomposites -= i;
+    memmove(compositelist, compositelist + i, numcomposites * sizeof(*compositelist));
+}
 
 static void GenerateTextureHashTable(void)
 {
@@ -869,6 +1067,8 @@ void R_InitTextures (void)
     texturewidth = Z_Malloc (numtextures * sizeof(*texturewidth), PU_STATIC, 0);
     textureheight = Z_Malloc (numtextures * sizeof(*textureheight), PU_STATIC, 0);
     texturebrightmap = Z_Malloc (numtextures * sizeof(*texturebrightmap), PU_STATIC, 0);
+    compositelastused = Z_Malloc (numtextures * sizeof(*compositelastused), PU_STATIC, 0);
+    compositelist = Z_Malloc (numtextures * sizeof(*compositelist), PU_STATIC, 0);
 
     //	Really complex printing shit...
     temp1 = W_GetNumForName (DEH_String("S_START"));  // P_???????
@@ -984,9 +1184,31 @@ void R_InitTextures (void)
     
     // Precalculate whatever possible.	
 
-    for (i=0 ; i<numtextures ; i++)
-	R_GenerateLookup (i);
+    // [crispy] in parallel, if there are load threads
+    lookupstatus = I_Realloc(NULL, numtextures * sizeof(*lookupstatus));
+    R_RunLoadJobs(numtextures, R_GenerateLookupJob);
+    R_ReportLookups();
     
+    //!
+    // @arg <mb>
+    // @category video
+    //
+    // Limit the memory used by composited wall textures to mb MiB,
+    // freeing the least recently drawn ones when it is exceeded.
+    // Defaults to 64, 0 means no limit.
+    //
+
+    i = M_CheckParmWithArgs("-compositecache", 1);
+
+    if (i > 0)
+    {
+	compositecache.budget = BETWEEN(0, 2047, atoi(myargv[i+1])) << 20;
+    }
+    else
+    {
+	compositecache.budget = 64 << 20;
+    }
+
     // Create translation table for global animation.
     texturetranslation = Z_Malloc ((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
     
@@ -1023,10 +1245,27 @@ void R_InitFlats (void)
 //  so the sprite does not need to be cached completely
 //  just for having the header info ready during rendering.
 //
+static void R_InitSpriteLumpsJob (int index, void *unused)
+{
+    const int last = MIN((index + 1) * LOADBATCH, numspritelumps);
+    int i;
+    patch_t *patch;
+
+    for (i = index * LOADBATCH; i < last; i++)
+    {
+	R_LockRenderCache();
+	patch = W_CacheLumpNum (firstspritelump+i, PU_CACHE);
+	R_UnlockRenderCache();
+
+	spritewidth[i] = SHORT(patch->width)<<FRACBITS;
+	spriteoffset[i] = SHORT(patch->leftoffset)<<FRACBITS;
+	spritetopoffset[i] = SHORT(patch->topoffset)<<FRACBITS;
+    }
+}
+
 void R_InitSpriteLumps (void)
 {
     int		i;
-    patch_t	*patch;
 	
     firstspritelump = W_GetNumForName (DEH_String("S_START")) + 1;
     lastspritelump = W_GetNumForName (DEH_String("S_END")) - 1;
@@ -1036,16 +1275,81 @@ void R_InitSpriteLumps (void)
     spriteoffset = Z_Malloc (numspritelumps*sizeof(*spriteoffset), PU_STATIC, 0);
     spritetopoffset = Z_Malloc (numspritelumps*sizeof(*spritetopoffset), PU_STATIC, 0);
 	
-    for (i=0 ; i< numspritelumps ; i++)
+    // [crispy] one mark for every 64 sprites, as before
+    for (i=0 ; i< numspritelumps ; i+=64)
+	printf (".");
+
+    R_RunLoadJobs(numspritelumps, R_InitSpriteLumpsJob);
+}
+
+// [crispy] cache the tables that are derived from the palette in the
+// configuration directory, so that they need not be recomputed on every
+// launch. Each cache file starts with a magic string and the exact data
+// that the table has been computed from, e.g. the whole PLAYPAL, and is
+// ignored if any of it differs.
+
+static const char palcache_magic[8] = {'C', 'R', 'I', 'S', 'P', 'Y', 'P', '1'};
+
+static boolean R_ReadPaletteCache (const char *name, const byte *key, size_t keylen,
+                                   byte *data, size_t datalen)
+{
+    char *filename;
+    FILE *fp;
+    char magic[sizeof(palcache_magic)];
+    byte *filekey;
+    boolean result = false;
+
+    filename = M_StringJoin(configdir, name, NULL);
+    fp = fopen(filename, "rb");
+    free(filename);
+
+    if (fp == NULL)
     {
-	if (!(i&63))
-	    printf (".");
+	return false;
+    }
 
-	patch = W_CacheLumpNum (firstspritelump+i, PU_CACHE);
-	spritewidth[i] = SHORT(patch->width)<<FRACBITS;
-	spriteoffset[i] = SHORT(patch->leftoffset)<<FRACBITS;
-	spritetopoffset[i] = SHORT(patch->topoffset)<<FRACBITS;
+    filekey = I_Realloc(NULL, keylen);
+
+    if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+        !memcmp(magic, palcache_magic, sizeof(magic)) &&
+        fread(filekey, 1, keylen, fp) == keylen &&
+        !memcmp(filekey, key, keylen) &&
+        fread(data, 1, datalen, fp) == datalen)
+    {
+	result = true;
+    }
+
+    free(filekey);
+    fclose(fp);
+
+    return result;
+}
+
+static void R_WritePaletteCache (const char *name, const byte *key, size_t keylen,
+                                 const byte *data, size_t datalen)
+{
+    char *filename;
+    FILE *fp;
+
+    filename = M_StringJoin(configdir, name, NULL);
+    fp = fopen(filename, "wb");
+
+    if (fp != NULL)
+    {
+	if (fwrite(palcache_magic, 1, sizeof(palcache_magic), fp) != sizeof(palcache_magic) ||
+	    fwrite(key, 1, keylen, fp) != keylen ||
+	    fwrite(data, 1, datalen, fp) != datalen)
+	{
+	    fclose(fp);
+	    remove(filename);
+	}
+	else
+	{
+	    fclose(fp);
+	}
     }
+
+    free(filename);
 }
 
 #ifndef CRISPY_TRUECOLOR
@@ -1074,8 +1378,20 @@ static void R_InitTranMap()
     {
 	// Compose a default transparent filter map based on PLAYPAL.
 	unsigned char *playpal = W_CacheLumpName("PLAYPAL", PU_STATIC);
+	byte key[1 + 256*3];
+
+	// [crispy] the map only depends on the filter and the first palette
+	key[0] = tran_filter_pct;
+	memcpy(key + 1, playpal, 256*3);
 
 	tranmap = Z_Malloc(256*256, PU_STATIC, 0);
+
+	// [crispy] loaded from the cache file
+	if (R_ReadPaletteCache("tranmap.dat", key, sizeof(key), tranmap, 256*256))
+	{
+	    printf(":");
+	}
+	else
 	{
 	    byte *fg, *bg, blend[3], *tp = tranmap;
 	    int i, j, btmp;
@@ -1108,9 +1424,11 @@ static void R_InitTranMap()
 		    *tp++ = V_GetPaletteIndex(playpal, blend[r], blend[g], blend[b]);
 		}
 	    }
-	}
 
-	printf(".");
+	    R_WritePaletteCache("tranmap.dat", key, sizeof(key), tranmap, 256*256);
+
+	    printf(".");
+	}
 
 	W_ReleaseLumpName("PLAYPAL");
     }
@@ -1203,6 +1521,8 @@ void R_InitColormaps (void)
 	char c[3];
 	int i, j;
 	boolean keepgray = false;
+	byte key[1 + 256*3];
+	static byte crcache[CRMAX - 2][256];
 
 	if (!crstr)
 	    crstr = I_Realloc(NULL, CRMAX * sizeof(*crstr));
@@ -1211,14 +1531,29 @@ void R_InitColormaps (void)
 	i = W_CheckNumForName(DEH_String("sttnum0")); // [crispy] Status Bar '0'
 	keepgray = (i >= 0 && W_IsIWADLump(lumpinfo[i]));
 
+	key[0] = keepgray;
+	memcpy(key + 1, playpal, 256*3);
+
 	// [crispy] CRMAX - 2: don't override the original GREN and BLUE2 Boom tables
-	for (i = 0; i < CRMAX - 2; i++)
+	if (!R_ReadPaletteCache("crtables.dat", key, sizeof(key),
+	                        (byte *) crcache, sizeof(crcache)))
 	{
-	    for (j = 0; j < 256; j++)
+	    for (i = 0; i < CRMAX - 2; i++)
 	    {
-		cr[i][j] = V_Colorize(playpal, i, j, keepgray);
+		for (j = 0; j < 256; j++)
+		{
+		    crcache[i][j] = V_Colorize(playpal, i, j, keepgray);
+		}
 	    }
 
+	    R_WritePaletteCache("crtables.dat", key, sizeof(key),
+	                        (byte *) crcache, sizeof(crcache));
+	}
+
+	for (i = 0; i < CRMAX - 2; i++)
+	{
+	    memcpy(cr[i], crcache[i], 256);
+
 	    M_snprintf(c, sizeof(c), "%c%c", cr_esc, '0' + i);
 	    crstr[i] = M_StringDuplicate(c);
 	}
@@ -41,8 +41,26 @@ R_GetColumnMod
   int		col );
 
 
+// [crispy] composite texture cache statistics
+typedef struct
+{
+    unsigned int hits;      // textures drawn in a frame that were already composited
+    unsigned int misses;    // textures that had to be composited
+    unsigned int evictions; // composites freed to stay within the budget
+    int bytes;              // memory used by all composites
+    int budget;             // -compositecache limit in bytes, 0 for none
+} compositecache_t;
+
+extern compositecache_t compositecache;
+
+// [crispy] evict composites if over budget, called once per frame
+void R_TrimCompositeCache (void);
+
 // I/O, setting up the stuff.
 void R_InitData (void);
+
+// [crispy] number of threads that set up the texture and sprite tables
+extern int numloadthreads;
 void R_PrecacheLevel (void);
 
 
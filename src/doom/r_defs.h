@@ -479,6 +479,10 @@ typedef struct
   int			lightlevel;
   int			minx;
   int			maxx;
+
+  // [crispy] index of the next visplane in the same R_FindPlane() hash
+  // chain, -1 at the end
+  int			next;
   
   // leave pads for [minx-1]/[maxx+1]
   
@@ -80,19 +80,19 @@ static pixel_t *background_buffer = NULL;
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap[2]; // [crispy] brightmaps
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
-int			dc_texheight; // [crispy] Tutti-Frutti fix
+THREADLOCAL lighttable_t*		dc_colormap[2]; // [crispy] brightmaps
+THREADLOCAL int			dc_x; 
+THREADLOCAL int			dc_yl; 
+THREADLOCAL int			dc_yh; 
+THREADLOCAL fixed_t			dc_iscale; 
+THREADLOCAL fixed_t			dc_texturemid;
+THREADLOCAL int			dc_texheight; // [crispy] Tutti-Frutti fix
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+THREADLOCAL byte*			dc_source;		
 
 // just for profiling 
-int			dccount;
+THREADLOCAL int			dccount;
 
 //
 // A column is a vertical slice/span from a wall texture that,
@@ -103,44 +103,116 @@ int			dccount;
 // 
 // [crispy] replace R_DrawColumn() with Lee Killough's implementation
 // found in MBF to fix Tutti-Frutti, taken from mbfsrc/R_DRAW.C:99-1979
+//
+// [crispy] All column drawers but the fuzz ones are generated from
+// R_DrawColumnGeneric() below. Its flags are compile-time constants
+// in each of the drawers, so the compiler removes every test of them
+// and the inner loops are left without branches. The drawer for a
+// combination of flags is picked once per column or sprite.
+//
 
-void R_DrawColumn (void) 
-{ 
-    int			count; 
+#define COLUMN_BRIGHTMAP    1 // look up the colormap in dc_brightmap
+#define COLUMN_TRANSLATED   2 // remap colors with dc_translation
+#define COLUMN_TRANSLUCENT  4 // blend with the framebuffer
+#define COLUMN_LOWDETAIL    8 // draw two screen columns
+
+#if defined(__GNUC__)
+#define ALWAYSINLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define ALWAYSINLINE __forceinline
+#else
+#define ALWAYSINLINE inline
+#endif
+
+static ALWAYSINLINE void R_PutColumnPixel (const int flags, const byte texel,
+                                           pixel_t *const dest, pixel_t *const dest2)
+{
+    const byte source = (flags & COLUMN_TRANSLATED) ? dc_translation[texel] : texel;
+
+    if (flags & COLUMN_TRANSLUCENT)
+    {
+#ifndef CRISPY_TRUECOLOR
+	// actual translucency map lookup taken from boom202s/R_DRAW.C:255
+	*dest = tranmap[(*dest<<8)+dc_colormap[0][source]];
+	if (flags & COLUMN_LOWDETAIL)
+	    *dest2 = tranmap[(*dest2<<8)+dc_colormap[0][source]];
+#else
+	const pixel_t destrgb = dc_colormap[0][source];
+	*dest = blendfunc(*dest, destrgb);
+	if (flags & COLUMN_LOWDETAIL)
+	    *dest2 = blendfunc(*dest2, destrgb);
+#endif
+    }
+    else
+    {
+	// [crispy] brightmaps
+	const pixel_t pixel = (flags & COLUMN_BRIGHTMAP) ?
+	                      dc_colormap[dc_brightmap[source]][source] :
+	                      dc_colormap[0][source];
+	*dest = pixel;
+	if (flags & COLUMN_LOWDETAIL)
+	    *dest2 = pixel;
+    }
+}
+
+static ALWAYSINLINE void R_DrawColumnGeneric (const int flags)
+{
+    int			count;
     pixel_t*		dest;
+    pixel_t*		dest2 = NULL;
     fixed_t		frac;
-    fixed_t		fracstep;	 
+    fixed_t		fracstep;
+    int			x;
     int			heightmask = dc_texheight - 1;
- 
-    count = dc_yh - dc_yl; 
+
+    count = dc_yh - dc_yl;
 
     // Zero length, column does not exceed a pixel.
-    if (count < 0) 
-	return; 
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
+    if (count < 0)
+	return;
+
+    // Blocky mode, need to multiply by 2.
+    x = (flags & COLUMN_LOWDETAIL) ? dc_x << 1 : dc_x;
+
+#ifdef RANGECHECK
+    if ((unsigned)x >= SCREENWIDTH
 	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT) 
-	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x); 
-#endif 
+	|| dc_yh >= SCREENHEIGHT)
+	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, x);
+#endif
 
     // Framebuffer destination address.
     // Use ylookup LUT to avoid multiply with ScreenWidth.
     // Use columnofs LUT for subwindows? 
-    dest = ylookup[dc_yl] + columnofs[flipviewwidth[dc_x]];
+    dest = ylookup[dc_yl] + columnofs[flipviewwidth[x]];
+
+    if (flags & COLUMN_LOWDETAIL)
+	dest2 = ylookup[dc_yl] + columnofs[flipviewwidth[x+1]];
 
     // Determine scaling,
     //  which is the only mapping to be done.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
 
     // Inner loop that does the actual texture mapping,
     //  e.g. a DDA-lile scaling.
     // This is as fast as it gets.
 
+  // [crispy] sprites, translated and translucent, are drawn as before
+  if (flags & (COLUMN_TRANSLATED | COLUMN_TRANSLUCENT))
+  {
+    do
+    {
+	R_PutColumnPixel(flags, dc_source[frac>>FRACBITS], dest, dest2);
+	dest += SCREENWIDTH;
+	if (flags & COLUMN_LOWDETAIL)
+	    dest2 += SCREENWIDTH;
+
+	frac += fracstep;
+    } while (count--);
+  }
   // heightmask is the Tutti-Frutti fix -- killough
-  if (dc_texheight & heightmask) // not a power of 2 -- killough
+  else if (dc_texheight & heightmask) // not a power of 2 -- killough
   {
     heightmask++;
     heightmask <<= FRACBITS;
@@ -153,31 +225,52 @@ void R_DrawColumn (void)
 
     do
     {
-	// [crispy] brightmaps
-	const byte source = dc_source[frac>>FRACBITS];
-	*dest = dc_colormap[dc_brightmap[source]][source];
-
+	R_PutColumnPixel(flags, dc_source[frac>>FRACBITS], dest, dest2);
 	dest += SCREENWIDTH;
+	if (flags & COLUMN_LOWDETAIL)
+	    dest2 += SCREENWIDTH;
+
 	if ((frac += fracstep) >= heightmask)
 	    frac -= heightmask;
     } while (count--);
   }
   else // texture height is a power of 2 -- killough
   {
-    do 
+    do
     {
 	// Re-map color indices from wall texture column
 	//  using a lighting/special effects LUT.
-	// [crispy] brightmaps
-	const byte source = dc_source[(frac>>FRACBITS)&heightmask];
-	*dest = dc_colormap[dc_brightmap[source]][source];
-	
-	dest += SCREENWIDTH; 
+	R_PutColumnPixel(flags, dc_source[(frac>>FRACBITS)&heightmask], dest, dest2);
+	dest += SCREENWIDTH;
+	if (flags & COLUMN_LOWDETAIL)
+	    dest2 += SCREENWIDTH;
+
 	frac += fracstep;
-	
-    } while (count--); 
+    } while (count--);
   }
-} 
+}
+
+// [crispy] brightmapped and plain opaque columns
+
+void R_DrawColumn (void)
+{
+    R_DrawColumnGeneric(COLUMN_BRIGHTMAP);
+}
+
+void R_DrawColumnLow (void)
+{
+    R_DrawColumnGeneric(COLUMN_BRIGHTMAP | COLUMN_LOWDETAIL);
+}
+
+void R_DrawPlainColumn (void)
+{
+    R_DrawColumnGeneric(0);
+}
+
+void R_DrawPlainColumnLow (void)
+{
+    R_DrawColumnGeneric(COLUMN_LOWDETAIL);
+}
 
 
 
@@ -240,82 +333,6 @@ void R_DrawColumn (void)
 #endif
 
 
-void R_DrawColumnLow (void) 
-{ 
-    int			count; 
-    pixel_t*		dest; 
-    pixel_t*		dest2;
-    fixed_t		frac;
-    fixed_t		fracstep;	 
-    int                 x;
-    int			heightmask = dc_texheight - 1;
- 
-    count = dc_yh - dc_yl; 
-
-    // Zero length.
-    if (count < 0) 
-	return; 
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	
-	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
-    }
-    //	dccount++; 
-#endif 
-    // Blocky mode, need to multiply by 2.
-    x = dc_x << 1;
-    
-    dest = ylookup[dc_yl] + columnofs[flipviewwidth[x]];
-    dest2 = ylookup[dc_yl] + columnofs[flipviewwidth[x+1]];
-    
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
-    
-  // heightmask is the Tutti-Frutti fix -- killough
-  if (dc_texheight & heightmask) // not a power of 2 -- killough
-  {
-    heightmask++;
-    heightmask <<= FRACBITS;
-
-    if (frac < 0)
-	while ((frac += heightmask) < 0);
-    else
-	while (frac >= heightmask)
-	    frac -= heightmask;
-
-    do
-    {
-	// [crispy] brightmaps
-	const byte source = dc_source[frac>>FRACBITS];
-	*dest2 = *dest = dc_colormap[dc_brightmap[source]][source];
-
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-
-	if ((frac += fracstep) >= heightmask)
-	    frac -= heightmask;
-    } while (count--);
-  }
-  else // texture height is a power of 2 -- killough
-  {
-    do 
-    {
-	// Hack. Does not work corretly.
-	// [crispy] brightmaps
-	const byte source = dc_source[(frac>>FRACBITS)&heightmask];
-	*dest2 = *dest = dc_colormap[dc_brightmap[source]][source];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-
-	frac += fracstep; 
-
-    } while (count--);
-  }
-}
 
 
 //
@@ -336,7 +353,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+THREADLOCAL int	fuzzpos = 0; 
 
 // [crispy] draw fuzz effect independent of rendering frame rate
 static int fuzzpos_tic;
@@ -525,193 +542,32 @@ void R_DrawFuzzColumnLow (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+THREADLOCAL byte*	dc_translation;
 byte*	translationtables;
 
-void R_DrawTranslatedColumn (void) 
-{ 
-    int			count; 
-    pixel_t*		dest;
-    fixed_t		frac;
-    fixed_t		fracstep;	 
- 
-    count = dc_yh - dc_yl; 
-    if (count < 0) 
-	return; 
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, dc_x);
-    }
-    
-#endif 
-
-
-    dest = ylookup[dc_yl] + columnofs[flipviewwidth[dc_x]];
-
-    // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
-
-    // Here we do an additional index re-mapping.
-    do 
-    {
-	// Translation tables are used
-	//  to map certain colorramps to other ones,
-	//  used with PLAY sprites.
-	// Thus the "green" ramp of the player 0 sprite
-	//  is mapped to gray, red, black/indigo. 
-	*dest = dc_colormap[0][dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
-	
-	frac += fracstep; 
-    } while (count--); 
-} 
-
-void R_DrawTranslatedColumnLow (void) 
-{ 
-    int			count; 
-    pixel_t*		dest; 
-    pixel_t*		dest2; 
-    fixed_t		frac;
-    fixed_t		fracstep;	 
-    int                 x;
- 
-    count = dc_yh - dc_yl; 
-    if (count < 0) 
-	return; 
-
-    // low detail, need to scale by 2
-    x = dc_x << 1;
-				 
-#ifdef RANGECHECK 
-    if ((unsigned)x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, x);
-    }
-    
-#endif 
-
-
-    dest = ylookup[dc_yl] + columnofs[flipviewwidth[x]];
-    dest2 = ylookup[dc_yl] + columnofs[flipviewwidth[x+1]];
-
-    // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+void R_DrawTranslatedColumn (void)
+{
+    R_DrawColumnGeneric(COLUMN_TRANSLATED);
+}
 
-    // Here we do an additional index re-mapping.
-    do 
-    {
-	// Translation tables are used
-	//  to map certain colorramps to other ones,
-	//  used with PLAY sprites.
-	// Thus the "green" ramp of the player 0 sprite
-	//  is mapped to gray, red, black/indigo. 
-	*dest = dc_colormap[0][dc_translation[dc_source[frac>>FRACBITS]]];
-	*dest2 = dc_colormap[0][dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-	
-	frac += fracstep; 
-    } while (count--); 
-} 
+void R_DrawTranslatedColumnLow (void)
+{
+    R_DrawColumnGeneric(COLUMN_TRANSLATED | COLUMN_LOWDETAIL);
+}
 
+//
+// R_DrawTLColumn
+// [crispy] Translucent sprites, blended with the framebuffer
+//  through tranmap, or blendfunc in truecolor mode.
+//
 void R_DrawTLColumn (void)
 {
-    int			count;
-    pixel_t*		dest;
-    fixed_t		frac;
-    fixed_t		fracstep;
-
-    count = dc_yh - dc_yl;
-    if (count < 0)
-	return;
-
-#ifdef RANGECHECK
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, dc_x);
-    }
-#endif
-
-    dest = ylookup[dc_yl] + columnofs[flipviewwidth[dc_x]];
-
-    fracstep = dc_iscale;
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
-
-    do
-    {
-#ifndef CRISPY_TRUECOLOR
-        // actual translucency map lookup taken from boom202s/R_DRAW.C:255
-        *dest = tranmap[(*dest<<8)+dc_colormap[0][dc_source[frac>>FRACBITS]]];
-#else
-        const pixel_t destrgb = dc_colormap[0][dc_source[frac>>FRACBITS]];
-        *dest = blendfunc(*dest, destrgb);
-#endif
-	dest += SCREENWIDTH;
-
-	frac += fracstep;
-    } while (count--);
+    R_DrawColumnGeneric(COLUMN_TRANSLUCENT);
 }
 
-// [crispy] draw translucent column, low-resolution version
 void R_DrawTLColumnLow (void)
 {
-    int			count;
-    pixel_t*		dest;
-    pixel_t*		dest2;
-    fixed_t		frac;
-    fixed_t		fracstep;
-    int                 x;
-
-    count = dc_yh - dc_yl;
-    if (count < 0)
-	return;
-
-    x = dc_x << 1;
-
-#ifdef RANGECHECK
-    if ((unsigned)x >= SCREENWIDTH
-	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
-    {
-	I_Error ( "R_DrawColumn: %i to %i at %i",
-		  dc_yl, dc_yh, x);
-    }
-#endif
-
-    dest = ylookup[dc_yl] + columnofs[flipviewwidth[x]];
-    dest2 = ylookup[dc_yl] + columnofs[flipviewwidth[x+1]];
-
-    fracstep = dc_iscale;
-    frac = dc_texturemid + (dc_yl-centery)*fracstep;
-
-    do
-    {
-#ifndef CRISPY_TRUECOLOR
-	*dest = tranmap[(*dest<<8)+dc_colormap[0][dc_source[frac>>FRACBITS]]];
-	*dest2 = tranmap[(*dest2<<8)+dc_colormap[0][dc_source[frac>>FRACBITS]]];
-#else
-	const pixel_t destrgb = dc_colormap[0][dc_source[frac>>FRACBITS]];
-	*dest = blendfunc(*dest, destrgb);
-	*dest2 = blendfunc(*dest2, destrgb);
-#endif
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
-
-	frac += fracstep;
-    } while (count--);
+    R_DrawColumnGeneric(COLUMN_TRANSLUCENT | COLUMN_LOWDETAIL);
 }
 
 //
@@ -761,23 +617,23 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+THREADLOCAL int			ds_y; 
+THREADLOCAL int			ds_x1; 
+THREADLOCAL int			ds_x2;
 
-lighttable_t*		ds_colormap[2];
-byte*			ds_brightmap;
+THREADLOCAL lighttable_t*		ds_colormap[2];
+THREADLOCAL byte*			ds_brightmap;
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+THREADLOCAL fixed_t			ds_xfrac; 
+THREADLOCAL fixed_t			ds_yfrac; 
+THREADLOCAL fixed_t			ds_xstep; 
+THREADLOCAL fixed_t			ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+THREADLOCAL byte*			ds_source;	
 
 // just for profiling
-int			dscount;
+THREADLOCAL int			dscount;
 
 
 //
@@ -34,9 +34,15 @@
 #include "m_menu.h"
 
 #include "i_system.h" // [crispy] I_Realloc()
+#include "i_thread.h" // [crispy] multithreaded rendering
+#include "i_timer.h" // [crispy] I_GetTimeUS()
+#include "m_argv.h" // [crispy] M_CheckParmWithArgs()
 #include "p_local.h" // [crispy] MLOOKUNIT
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_simd.h" // [crispy] R_SelectSIMDDrawers()
+#include "d_profile.h" // [crispy] frame profiler
+#include "z_zone.h" // [crispy] Z_SuspendPurge()
 #include "st_stuff.h" // [crispy] ST_refreshBackground()
 #include "a11y.h" // [crispy] A11Y
 
@@ -56,7 +62,7 @@ int			validcount = 1;
 
 
 lighttable_t*		fixedcolormap;
-extern lighttable_t**	walllights;
+extern THREADLOCAL lighttable_t**	walllights;
 
 int			centerx;
 int			centery;
@@ -68,7 +74,7 @@ fixed_t			projection;
 // just for profiling purposes
 int			framecount;	
 
-int			sscount;
+THREADLOCAL int			sscount;
 int			linecount;
 int			loopcount;
 
@@ -120,13 +126,21 @@ int MAXLIGHTZ;
 int LIGHTZSHIFT;
 
 
-void (*colfunc) (void);
+THREADLOCAL void (*colfunc) (void);
 void (*basecolfunc) (void);
+void (*brightcolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
 void (*tlcolfunc) (void);
 void (*spanfunc) (void);
 
+// [crispy] multithreaded rendering: each render thread draws
+// the columns viewstripx1 to viewstripx2 of the view
+int			numrenderthreads = 1;
+THREADLOCAL int		viewstripx1;
+THREADLOCAL int		viewstripx2;
+static i_mutex_t*	rendercachelock;
+
 
 
 //
@@ -739,7 +753,7 @@ void R_InitLightTables (void)
 	LIGHTZSHIFT = 20;
     }
 
-    scalelight = malloc(LIGHTLEVELS * sizeof(*scalelight));
+    scalelight = calloc(LIGHTLEVELS, sizeof(*scalelight));
     scalelightfixed = malloc(MAXLIGHTSCALE * sizeof(*scalelightfixed));
     zlight = malloc(LIGHTLEVELS * sizeof(*zlight));
 
@@ -793,6 +807,64 @@ R_SetViewSize
     setdetail = detail;
 }
 
+// [crispy] dynamic resolution: target time in ms to draw a frame, 0 is off
+int		dynamic_resolution = 0;
+
+// [crispy] the view is temporarily drawn in low detail
+static boolean	dynamiclowdetail = false;
+
+// [crispy] time of the last R_RenderPlayerView() in microseconds
+static int	viewtime;
+
+//
+// R_DynamicResolution
+// [crispy] called once per frame with the time it took to draw it.
+// Falls back to low detail if the frames take longer than the target,
+// and returns to high detail once the frames would fit into the target
+// again with some headroom. The status bar and HUD are not affected.
+//
+void R_DynamicResolution (int frametime)
+{
+    static int frameavg, viewavg;
+    static int lastswitch;
+    const int target = dynamic_resolution * 1000;
+    boolean lowdetail = dynamiclowdetail;
+
+    if (target <= 0 || setdetail)
+    {
+	lowdetail = false;
+    }
+    else
+    {
+	// [crispy] average over the last few frames
+	frameavg += (frametime - frameavg) / 8;
+	viewavg += (viewtime - viewavg) / 8;
+
+	// [crispy] switch at most once per second
+	if (I_GetTimeMS() - lastswitch < 1000)
+	{
+	    return;
+	}
+
+	if (!dynamiclowdetail)
+	{
+	    lowdetail = frameavg > target;
+	}
+	else
+	{
+	    // [crispy] high detail about doubles the time to draw the view
+	    lowdetail = frameavg + viewavg > target * 3 / 4;
+	}
+    }
+
+    if (lowdetail != dynamiclowdetail)
+    {
+	dynamiclowdetail = lowdetail;
+	lastswitch = I_GetTimeMS();
+	R_SetViewSize (setblocks, setdetail);
+    }
+}
+
 
 //
 // R_ExecuteSetViewSize
@@ -842,7 +914,7 @@ void R_ExecuteSetViewSize (void)
 	}
     }
     
-    detailshift = setdetail;
+    detailshift = setdetail || dynamiclowdetail;
     viewwidth = scaledviewwidth>>detailshift;
     viewwidth_nonwide = scaledviewwidth_nonwide>>detailshift;
 	
@@ -855,15 +927,21 @@ void R_ExecuteSetViewSize (void)
 
     if (!detailshift)
     {
-	colfunc = basecolfunc = R_DrawColumn;
+	colfunc = basecolfunc = R_DrawPlainColumn;
+	brightcolfunc = R_DrawColumn;
 	fuzzcolfunc = R_DrawFuzzColumn;
 	transcolfunc = R_DrawTranslatedColumn;
 	tlcolfunc = R_DrawTLColumn;
 	spanfunc = R_DrawSpan;
+#ifdef HAVE_SIMD_DRAWERS
+	// [crispy] vectorized drawers, if the CPU supports them
+	R_SelectSIMDDrawers(&brightcolfunc, &spanfunc);
+#endif
     }
     else
     {
-	colfunc = basecolfunc = R_DrawColumnLow;
+	colfunc = basecolfunc = R_DrawPlainColumnLow;
+	brightcolfunc = R_DrawColumnLow;
 	fuzzcolfunc = R_DrawFuzzColumnLow;
 	transcolfunc = R_DrawTranslatedColumnLow;
 	tlcolfunc = R_DrawTLColumnLow;
@@ -907,7 +985,11 @@ void R_ExecuteSetViewSize (void)
     //  for each level / scale combination.
     for (i=0 ; i< LIGHTLEVELS ; i++)
     {
-	scalelight[i] = malloc(MAXLIGHTSCALE * sizeof(**scalelight));
+	// [crispy] the view size may change often with dynamic resolution
+	if (!scalelight[i])
+	{
+	    scalelight[i] = malloc(MAXLIGHTSCALE * sizeof(**scalelight));
+	}
 
 	startmap = ((LIGHTLEVELS-LIGHTBRIGHT-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTSCALE ; j++)
@@ -938,6 +1020,85 @@ void R_ExecuteSetViewSize (void)
 
 
 
+//
+// R_InitRenderThreads
+// [crispy] multithreaded rendering
+//
+static void R_InitRenderThreads (void)
+{
+    int p;
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Render the view with n threads, each drawing a vertical strip
+    // of the screen.
+    //
+
+    p = M_CheckParmWithArgs("-renderthreads", 1);
+
+    if (p > 0)
+    {
+	numrenderthreads = BETWEEN(1, MAXTHREADS, atoi(myargv[p+1]));
+    }
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Draw the floors and ceilings with n threads. Unlike
+    // -renderthreads, this leaves the rest of the renderer
+    // single-threaded and gives exactly the same output.
+    //
+
+    p = M_CheckParmWithArgs("-planethreads", 1);
+
+    if (p > 0)
+    {
+	numplanethreads = BETWEEN(1, MAXTHREADS, atoi(myargv[p+1]));
+    }
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Generate the texture column lookups and the sprite tables with
+    // n threads at startup. Defaults to the number of render or
+    // plane threads.
+    //
+
+    p = M_CheckParmWithArgs("-loadthreads", 1);
+
+    if (p > 0)
+    {
+	numloadthreads = BETWEEN(1, MAXTHREADS, atoi(myargv[p+1]));
+    }
+    else
+    {
+	numloadthreads = MAX(numrenderthreads, numplanethreads);
+    }
+
+    // the render threads already draw the planes of their strips
+    if (numrenderthreads > 1)
+    {
+	numplanethreads = 1;
+    }
+
+    if (numrenderthreads > 1 || numplanethreads > 1 || numloadthreads > 1)
+    {
+	I_InitThreads(MAX(MAX(numrenderthreads, numplanethreads), numloadthreads));
+	numrenderthreads = MIN(numrenderthreads, I_NumThreads());
+	numplanethreads = MIN(numplanethreads, I_NumThreads());
+	numloadthreads = MIN(numloadthreads, I_NumThreads());
+    }
+
+    if (numrenderthreads > 1 || numplanethreads > 1 || numloadthreads > 1)
+    {
+	rendercachelock = I_CreateMutex();
+    }
+}
+
 //
 // R_Init
 //
@@ -946,6 +1107,8 @@ void R_ExecuteSetViewSize (void)
 
 void R_Init (void)
 {
+    // [crispy] R_InitData() already uses the worker threads
+    R_InitRenderThreads ();
     R_InitData ();
     printf (".");
     R_InitPointToAngle ();
@@ -1085,6 +1248,59 @@ void R_SetupFrame (player_t* player)
 		
     framecount++;
     validcount++;
+
+    viewstripx1 = 0;
+    viewstripx2 = viewwidth - 1;
+}
+
+//
+// R_LockRenderCache
+// [crispy] serialize zone memory access of the render threads
+//
+void R_LockRenderCache (void)
+{
+    if (rendercachelock)
+    {
+	I_LockMutex(rendercachelock);
+    }
+}
+
+void R_UnlockRenderCache (void)
+{
+    if (rendercachelock)
+    {
+	I_UnlockMutex(rendercachelock);
+    }
+}
+
+//
+// R_RenderViewStrip
+// [crispy] called in a render thread, every one of which walks the
+// complete BSP tree (so that the clipping is exactly the same as in the
+// single-threaded renderer) but only draws the columns of its own strip
+//
+static void R_RenderViewStrip (int index, void *unused)
+{
+    viewstripx1 = viewwidth * index / numrenderthreads;
+    viewstripx2 = viewwidth * (index + 1) / numrenderthreads - 1;
+
+    // [crispy] usually set up on the main thread only
+    colfunc = basecolfunc;
+
+    if (fixedcolormap)
+	walllights = scalelightfixed;
+
+    R_ClearClipSegs ();
+    R_ClearDrawSegs ();
+    R_ClearPlanes ();
+    R_ClearSprites ();
+
+    R_RenderBSPNode (numnodes-1);
+    R_DrawPlanes ();
+
+    // [crispy] draw fuzz effect independent of rendering frame rate
+    R_SetFuzzPosDraw();
+    R_DrawMasked ();
 }
 
 
@@ -1096,6 +1312,10 @@ void R_RenderPlayerView (player_t* player)
 {	
     extern void V_DrawFilledBox (int x, int y, int w, int h, int c);
     extern void R_InterpolateTextureOffsets (void);
+    uint64_t viewstart;
+
+    // [crispy] no render thread is running between two frames
+    R_TrimCompositeCache ();
 
     R_SetupFrame (player);
 
@@ -1106,9 +1326,13 @@ void R_RenderPlayerView (player_t* player)
     R_ClearSprites ();
     if (automapactive && !crispy->automapoverlay)
     {
+        D_ProfileBegin(PROF_BSP);
         R_RenderBSPNode (numnodes-1);
+        D_ProfileEnd(PROF_BSP);
         return;
     }
+
+    viewstart = I_GetTimeUS();
     
     // [crispy] flashing HOM indicator
     V_DrawFilledBox(viewwindowx, viewwindowy,
@@ -1124,21 +1348,60 @@ void R_RenderPlayerView (player_t* player)
 
     // [crispy] smooth texture scrolling
     R_InterpolateTextureOffsets();
-    // The head node is the last node output.
-    R_RenderBSPNode (numnodes-1);
-    
-    // Check for new console commands.
-    NetUpdate ();
-    
-    R_DrawPlanes ();
-    
-    // Check for new console commands.
-    NetUpdate ();
-    
-    // [crispy] draw fuzz effect independent of rendering frame rate
-    R_SetFuzzPosDraw();
-    R_DrawMasked ();
+
+    if (numrenderthreads > 1)
+    {
+	// [crispy] keep the render threads from writing to shared data
+	R_LockSectors(true);
+	Z_SuspendPurge(true);
+
+	// [crispy] the strips can not be told apart by phase
+	D_ProfileBegin(PROF_BSP);
+	I_RunThreadJobs(numrenderthreads, numrenderthreads,
+	                R_RenderViewStrip, NULL);
+	D_ProfileEnd(PROF_BSP);
+
+	Z_SuspendPurge(false);
+	R_LockSectors(false);
+
+	viewstripx1 = 0;
+	viewstripx2 = viewwidth - 1;
+    }
+    else
+    {
+	// The head node is the last node output.
+	D_ProfileBegin(PROF_BSP);
+	R_RenderBSPNode (numnodes-1);
+	D_ProfileEnd(PROF_BSP);
+
+	// Check for new console commands.
+	NetUpdate ();
+
+	D_ProfileBegin(PROF_PLANES);
+	R_DrawPlanes ();
+	D_ProfileEnd(PROF_PLANES);
+
+	// Check for new console commands.
+	NetUpdate ();
+
+	// [crispy] draw fuzz effect independent of rendering frame rate
+	R_SetFuzzPosDraw();
+	D_ProfileBegin(PROF_MASKED);
+	R_DrawMasked ();
+	D_ProfileEnd(PROF_MASKED);
+    }
+
+    // draw the psprites on top of everything
+    //  but does not draw on side views
+    if (crispy->cleanscreenshot != 2 && !viewangleoffset)
+    {
+	D_ProfileBegin(PROF_MASKED);
+	R_DrawPlayerSprites ();
+	D_ProfileEnd(PROF_MASKED);
+    }
 
     // Check for new console commands.
     NetUpdate ();				
+
+    viewtime = (int) (I_GetTimeUS() - viewstart);
 }
@@ -45,6 +45,7 @@ extern fixed_t		centeryfrac;
 extern fixed_t		projection;
 
 extern int		validcount;
+extern int		framecount;
 
 extern int		linecount;
 extern int		loopcount;
@@ -93,14 +94,27 @@ extern	int		detailshift;
 // Function pointers to switch refresh/drawing functions.
 // Used to select shadow mode etc.
 //
-extern void		(*colfunc) (void);
+extern THREADLOCAL void	(*colfunc) (void);
 extern void		(*transcolfunc) (void);
 extern void		(*basecolfunc) (void);
+extern void		(*brightcolfunc) (void); // [crispy] brightmapped basecolfunc
 extern void		(*fuzzcolfunc) (void);
 extern void		(*tlcolfunc) (void);
 // No shadow effects on floors.
 extern void		(*spanfunc) (void);
 
+// [crispy] multithreaded rendering
+extern int		numrenderthreads;
+extern THREADLOCAL int	viewstripx1;
+extern THREADLOCAL int	viewstripx2;
+
+void R_LockRenderCache (void);
+void R_UnlockRenderCache (void);
+
+// [crispy] dynamic resolution
+extern int		dynamic_resolution;
+void R_DynamicResolution (int frametime);
+
 
 //
 // Utility functions.
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 
 #include "i_system.h"
+#include "i_thread.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -39,22 +40,33 @@
 planefunction_t		floorfunc;
 planefunction_t		ceilingfunc;
 
+// [crispy] number of threads drawing the visplanes
+int			numplanethreads = 1;
+
 //
 // opening
 //
 
 // Here comes the obnoxious "visplane".
 #define MAXVISPLANES	128
-visplane_t*		visplanes = NULL;
-visplane_t*		lastvisplane;
-visplane_t*		floorplane;
-visplane_t*		ceilingplane;
-static int		numvisplanes;
+THREADLOCAL visplane_t*		visplanes = NULL;
+THREADLOCAL visplane_t*		lastvisplane;
+THREADLOCAL visplane_t*		floorplane;
+THREADLOCAL visplane_t*		ceilingplane;
+static THREADLOCAL int		numvisplanes;
+
+// [crispy] hash chains of the visplanes created by R_FindPlane(),
+// which are unique in height, picnum and lightlevel
+#define VISPLANEHASHSIZE	128
+#define VISPLANEHASH(height, picnum, lightlevel) \
+	(((unsigned int) ((height) >> FRACBITS) * 7 \
+	  + (unsigned int) (picnum) * 3 + (lightlevel)) & (VISPLANEHASHSIZE - 1))
+static THREADLOCAL int		visplanehash[VISPLANEHASHSIZE];
 
 // ?
 #define MAXOPENINGS	MAXWIDTH*64*4
-int			openings[MAXOPENINGS]; // [crispy] 32-bit integer math
-int*			lastopening; // [crispy] 32-bit integer math
+static THREADLOCAL int*	openings; // [crispy] 32-bit integer math
+THREADLOCAL int*			lastopening; // [crispy] 32-bit integer math
 
 
 //
@@ -62,32 +74,32 @@ int*			lastopening; // [crispy] 32-bit integer math
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-int			floorclip[MAXWIDTH]; // [crispy] 32-bit integer math
-int			ceilingclip[MAXWIDTH]; // [crispy] 32-bit integer math
+THREADLOCAL int			floorclip[MAXWIDTH]; // [crispy] 32-bit integer math
+THREADLOCAL int			ceilingclip[MAXWIDTH]; // [crispy] 32-bit integer math
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[MAXHEIGHT];
-int			spanstop[MAXHEIGHT];
+THREADLOCAL int			spanstart[MAXHEIGHT];
+THREADLOCAL int			spanstop[MAXHEIGHT];
 
 //
 // texture mapping
 //
-lighttable_t**		planezlight;
-fixed_t			planeheight;
+THREADLOCAL lighttable_t**		planezlight;
+THREADLOCAL fixed_t			planeheight;
 
 fixed_t*			yslope;
 fixed_t			yslopes[LOOKDIRS][MAXHEIGHT];
 fixed_t			distscale[MAXWIDTH];
-fixed_t			basexscale;
-fixed_t			baseyscale;
+THREADLOCAL fixed_t			basexscale;
+THREADLOCAL fixed_t			baseyscale;
 
-fixed_t			cachedheight[MAXHEIGHT];
-fixed_t			cacheddistance[MAXHEIGHT];
-fixed_t			cachedxstep[MAXHEIGHT];
-fixed_t			cachedystep[MAXHEIGHT];
+THREADLOCAL fixed_t			cachedheight[MAXHEIGHT];
+THREADLOCAL fixed_t			cacheddistance[MAXHEIGHT];
+THREADLOCAL fixed_t			cachedxstep[MAXHEIGHT];
+THREADLOCAL fixed_t			cachedystep[MAXHEIGHT];
 
 
 
@@ -202,8 +214,17 @@ void R_ClearPlanes (void)
 	ceilingclip[i] = -1;
     }
 
+    // [crispy] allocated separately for each render thread
+    if (!openings)
+    {
+	openings = I_Realloc(NULL, MAXOPENINGS * sizeof(*openings));
+    }
+
     lastvisplane = visplanes;
     lastopening = openings;
+
+    // [crispy] empty all hash chains
+    memset (visplanehash, 0xff, sizeof(visplanehash));
     
     // texture calculation
     memset (cachedheight, 0, sizeof(cachedheight));
@@ -253,6 +274,8 @@ R_FindPlane
   int		lightlevel )
 {
     visplane_t*	check;
+    unsigned int	hash;
+    int		i;
 	
     // [crispy] add support for MBF sky tranfers
     if (picnum == skyflatnum || picnum & PL_SKYFLAT)
@@ -261,20 +284,24 @@ R_FindPlane
 	lightlevel = 0;
     }
 	
-    for (check=visplanes; check<lastvisplane; check++)
+    // [crispy] look up the hash chain instead of all visplanes, planes
+    // split off by R_CheckPlane() are never found by the linear search
+    // anyway because the one they were split from comes first
+    hash = VISPLANEHASH(height, picnum, lightlevel);
+
+    for (i = visplanehash[hash]; i != -1; i = visplanes[i].next)
     {
+	check = &visplanes[i];
+
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
     }
-    
-			
-    if (check < lastvisplane)
-	return check;
-		
+
+    check = lastvisplane;
     R_RaiseVisplanes(&check); // [crispy] remove VISPLANES limit
     if (lastvisplane - visplanes == MAXVISPLANES && false)
 	I_Error ("R_FindPlane: no more visplanes");
@@ -286,6 +313,9 @@ R_FindPlane
     check->lightlevel = lightlevel;
     check->minx = SCREENWIDTH;
     check->maxx = -1;
+
+    check->next = visplanehash[hash];
+    visplanehash[hash] = check - visplanes;
     
     memset (check->top,0xff,sizeof(check->top));
 		
@@ -404,17 +434,152 @@ R_MakeSpans
 
 
 //
-// R_DrawPlanes
-// At the end of each frame.
+// R_DrawPlane
 //
-void R_DrawPlanes (void)
+static void R_DrawPlane (visplane_t *pl)
 {
-    visplane_t*		pl;
     int			light;
     int			x;
     int			stop;
     int			angle;
     int                 lumpnum;
+    boolean		swirling;
+
+    if (pl->minx > pl->maxx)
+	return;
+
+	
+    // sky flat
+    // [crispy] add support for MBF sky tranfers
+    if (pl->picnum == skyflatnum || pl->picnum & PL_SKYFLAT)
+    {
+	int texture;
+	angle_t an = viewangle, flip;
+	if (pl->picnum & PL_SKYFLAT)
+	{
+	    const line_t *l = &lines[pl->picnum & ~PL_SKYFLAT];
+	    const side_t *s = *l->sidenum + sides;
+	    texture = texturetranslation[s->toptexture];
+	    dc_texturemid = s->rowoffset - 28*FRACUNIT;
+	    // [crispy] stretch sky
+	    if (crispy->stretchsky)
+	    {
+		dc_texturemid = dc_texturemid * (textureheight[texture]>>FRACBITS) / SKYSTRETCH_HEIGHT;
+	    }
+	    flip = (l->special == 272) ? 0u : ~0u;
+	    an += s->textureoffset;
+	}
+	else
+	{
+	    texture = skytexture;
+	    dc_texturemid = skytexturemid;
+	    flip = 0;
+	}
+	dc_iscale = pspriteiscale>>detailshift;
+	
+	// Sky is allways drawn full bright,
+	//  i.e. colormaps[0] is used.
+	// Because of this hack, sky is not affected
+	//  by INVUL inverse mapping.
+	// [crispy] no brightmaps for sky
+	dc_colormap[0] = dc_colormap[1] = colormaps;
+//	dc_texturemid = skytexturemid;
+	dc_texheight = textureheight[texture]>>FRACBITS; // [crispy] Tutti-Frutti fix
+	// [crispy] stretch sky
+	if (crispy->stretchsky)
+	    dc_iscale = dc_iscale * dc_texheight / SKYSTRETCH_HEIGHT;
+	for (x=pl->minx ; x <= pl->maxx ; x++)
+	{
+	    dc_yl = pl->top[x];
+	    dc_yh = pl->bottom[x];
+
+	    if ((unsigned) dc_yl <= dc_yh) // [crispy] 32-bit integer math
+	    {
+		angle = ((an + xtoviewangle[x])^flip)>>ANGLETOSKYSHIFT;
+		dc_x = x;
+		dc_source = R_GetColumn(texture, angle);
+		colfunc ();
+	    }
+	}
+	return;
+    }
+    
+    swirling = (flattranslation[pl->picnum] == -1);
+    // regular flat
+    lumpnum = firstflat + (swirling ? pl->picnum : flattranslation[pl->picnum]);
+    // [crispy] add support for SMMU swirling flats
+    R_LockRenderCache();
+    ds_source = swirling ? R_DistortedFlat(lumpnum) : W_CacheLumpNum(lumpnum, PU_STATIC);
+    R_UnlockRenderCache();
+    ds_brightmap = R_BrightmapForFlatNum(lumpnum-firstflat);
+    
+    planeheight = abs(pl->height-viewz);
+    light = (pl->lightlevel >> LIGHTSEGSHIFT)+(extralight * LIGHTBRIGHT);
+
+    if (light >= LIGHTLEVELS)
+	light = LIGHTLEVELS-1;
+
+    if (light < 0)
+	light = 0;
+
+    planezlight = zlight[light];
+
+    pl->top[pl->maxx+1] = 0xffffffffu; // [crispy] hires / 32-bit integer math
+    pl->top[pl->minx-1] = 0xffffffffu; // [crispy] hires / 32-bit integer math
+	    
+    stop = pl->maxx + 1;
+
+    for (x=pl->minx ; x<= stop ; x++)
+    {
+	R_MakeSpans(x,pl->top[x-1],
+		    pl->bottom[x-1],
+		    pl->top[x],
+		    pl->bottom[x]);
+    }
+    
+    R_LockRenderCache();
+    W_ReleaseLumpNum(lumpnum);
+    R_UnlockRenderCache();
+}
+
+//
+// R_DrawPlaneJob
+// [crispy] draw one visplane in a worker thread. The span state is
+// thread-local, so that every worker draws with its own.
+//
+typedef struct
+{
+    visplane_t *visplanes;
+    fixed_t basexscale;
+    fixed_t baseyscale;
+} planejobs_t;
+
+static void R_DrawPlaneJob (int index, void *data)
+{
+    const planejobs_t *const jobs = data;
+    static THREADLOCAL int planeframe = -1;
+
+    // the cached distances and steps are only valid for the current frame
+    if (planeframe != framecount)
+    {
+	memset(cachedheight, 0, sizeof(cachedheight));
+	planeframe = framecount;
+    }
+
+    basexscale = jobs->basexscale;
+    baseyscale = jobs->baseyscale;
+    colfunc = basecolfunc;
+
+    R_DrawPlane(&jobs->visplanes[index]);
+}
+
+//
+// R_DrawPlanes
+// At the end of each frame.
+//
+void R_DrawPlanes (void)
+{
+    visplane_t*		pl;
 				
 #ifdef RANGECHECK
     if (ds_p - drawsegs > numdrawsegs)
@@ -430,100 +595,25 @@ void R_DrawPlanes (void)
 		 lastopening - openings);
 #endif
 
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    // [crispy] visplanes never overlap, so they can be drawn in parallel
+    if (numplanethreads > 1)
     {
-	boolean swirling;
-
-	if (pl->minx > pl->maxx)
-	    continue;
+	planejobs_t jobs;
 
-	
-	// sky flat
-	// [crispy] add support for MBF sky tranfers
-	if (pl->picnum == skyflatnum || pl->picnum & PL_SKYFLAT)
-	{
-	    int texture;
-	    angle_t an = viewangle, flip;
-	    if (pl->picnum & PL_SKYFLAT)
-	    {
-		const line_t *l = &lines[pl->picnum & ~PL_SKYFLAT];
-		const side_t *s = *l->sidenum + sides;
-		texture = texturetranslation[s->toptexture];
-		dc_texturemid = s->rowoffset - 28*FRACUNIT;
-		// [crispy] stretch sky
-		if (crispy->stretchsky)
-		{
-		    dc_texturemid = dc_texturemid * (textureheight[texture]>>FRACBITS) / SKYSTRETCH_HEIGHT;
-		}
-		flip = (l->special == 272) ? 0u : ~0u;
-		an += s->textureoffset;
-	    }
-	    else
-	    {
-		texture = skytexture;
-		dc_texturemid = skytexturemid;
-		flip = 0;
-	    }
-	    dc_iscale = pspriteiscale>>detailshift;
-	    
-	    // Sky is allways drawn full bright,
-	    //  i.e. colormaps[0] is used.
-	    // Because of this hack, sky is not affected
-	    //  by INVUL inverse mapping.
-	    // [crispy] no brightmaps for sky
-	    dc_colormap[0] = dc_colormap[1] = colormaps;
-//	    dc_texturemid = skytexturemid;
-	    dc_texheight = textureheight[texture]>>FRACBITS; // [crispy] Tutti-Frutti fix
-	    // [crispy] stretch sky
-	    if (crispy->stretchsky)
-	        dc_iscale = dc_iscale * dc_texheight / SKYSTRETCH_HEIGHT;
-	    for (x=pl->minx ; x <= pl->maxx ; x++)
-	    {
-		dc_yl = pl->top[x];
-		dc_yh = pl->bottom[x];
-
-		if ((unsigned) dc_yl <= dc_yh) // [crispy] 32-bit integer math
-		{
-		    angle = ((an + xtoviewangle[x])^flip)>>ANGLETOSKYSHIFT;
-		    dc_x = x;
-		    dc_source = R_GetColumn(texture, angle);
-		    colfunc ();
-		}
-	    }
-	    continue;
-	}
-	
-	swirling = (flattranslation[pl->picnum] == -1);
-	// regular flat
-        lumpnum = firstflat + (swirling ? pl->picnum : flattranslation[pl->picnum]);
-	// [crispy] add support for SMMU swirling flats
-	ds_source = swirling ? R_DistortedFlat(lumpnum) : W_CacheLumpNum(lumpnum, PU_STATIC);
-	ds_brightmap = R_BrightmapForFlatNum(lumpnum-firstflat);
-	
-	planeheight = abs(pl->height-viewz);
-	light = (pl->lightlevel >> LIGHTSEGSHIFT)+(extralight * LIGHTBRIGHT);
-
-	if (light >= LIGHTLEVELS)
-	    light = LIGHTLEVELS-1;
+	jobs.visplanes = visplanes;
+	jobs.basexscale = basexscale;
+	jobs.baseyscale = baseyscale;
 
-	if (light < 0)
-	    light = 0;
+	Z_SuspendPurge(true);
+	I_RunThreadJobs(lastvisplane - visplanes, numplanethreads,
+	                R_DrawPlaneJob, &jobs);
+	Z_SuspendPurge(false);
 
-	planezlight = zlight[light];
-
-	pl->top[pl->maxx+1] = 0xffffffffu; // [crispy] hires / 32-bit integer math
-	pl->top[pl->minx-1] = 0xffffffffu; // [crispy] hires / 32-bit integer math
-		
-	stop = pl->maxx + 1;
+	return;
+    }
 
-	for (x=pl->minx ; x<= stop ; x++)
-	{
-	    R_MakeSpans(x,pl->top[x-1],
-			pl->bottom[x-1],
-			pl->top[x],
-			pl->bottom[x]);
-	}
-	
-        W_ReleaseLumpNum(lumpnum);
+    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    {
+	R_DrawPlane(pl);
     }
 }
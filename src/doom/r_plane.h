@@ -27,7 +27,7 @@
 #define PL_SKYFLAT (0x80000000)
 
 // Visplane related.
-extern  int*		lastopening; // [crispy] 32-bit integer math
+extern THREADLOCAL int*		lastopening; // [crispy] 32-bit integer math
 
 
 typedef void (*planefunction_t) (int top, int bottom);
@@ -35,8 +35,10 @@ typedef void (*planefunction_t) (int top, int bottom);
 extern planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern int		floorclip[MAXWIDTH]; // [crispy] 32-bit integer math
-extern int		ceilingclip[MAXWIDTH]; // [crispy] 32-bit integer math
+extern int		numplanethreads;
+
+extern THREADLOCAL int		floorclip[MAXWIDTH]; // [crispy] 32-bit integer math
+extern THREADLOCAL int		ceilingclip[MAXWIDTH]; // [crispy] 32-bit integer math
 
 extern fixed_t*	yslope;
 extern fixed_t		yslopes[LOOKDIRS][MAXHEIGHT];
@@ -37,56 +37,56 @@
 // OPTIMIZE: closed two sided lines as single sided
 
 // True if any of the segs textures might be visible.
-boolean		segtextured;	
+THREADLOCAL boolean		segtextured;	
 
 // False if the back side is the same plane.
-boolean		markfloor;	
-boolean		markceiling;
+THREADLOCAL boolean		markfloor;	
+THREADLOCAL boolean		markceiling;
 
-boolean		maskedtexture;
-int		toptexture;
-int		bottomtexture;
-int		midtexture;
+THREADLOCAL boolean		maskedtexture;
+THREADLOCAL int		toptexture;
+THREADLOCAL int		bottomtexture;
+THREADLOCAL int		midtexture;
 
 
-angle_t		rw_normalangle;
+THREADLOCAL angle_t		rw_normalangle;
 // angle to line origin
-int		rw_angle1;	
+THREADLOCAL int		rw_angle1;	
 
 //
 // regular wall
 //
-int		rw_x;
-int		rw_stopx;
-angle_t		rw_centerangle;
-fixed_t		rw_offset;
-fixed_t		rw_distance;
-fixed_t		rw_scale;
-fixed_t		rw_scalestep;
-fixed_t		rw_midtexturemid;
-fixed_t		rw_toptexturemid;
-fixed_t		rw_bottomtexturemid;
+THREADLOCAL int		rw_x;
+THREADLOCAL int		rw_stopx;
+THREADLOCAL angle_t		rw_centerangle;
+THREADLOCAL fixed_t		rw_offset;
+THREADLOCAL fixed_t		rw_distance;
+THREADLOCAL fixed_t		rw_scale;
+THREADLOCAL fixed_t		rw_scalestep;
+THREADLOCAL fixed_t		rw_midtexturemid;
+THREADLOCAL fixed_t		rw_toptexturemid;
+THREADLOCAL fixed_t		rw_bottomtexturemid;
 
-int		worldtop;
-int		worldbottom;
-int		worldhigh;
-int		worldlow;
+THREADLOCAL int		worldtop;
+THREADLOCAL int		worldbottom;
+THREADLOCAL int		worldhigh;
+THREADLOCAL int		worldlow;
 
-int64_t		pixhigh; // [crispy] WiggleFix
-int64_t		pixlow; // [crispy] WiggleFix
-fixed_t		pixhighstep;
-fixed_t		pixlowstep;
+THREADLOCAL int64_t		pixhigh; // [crispy] WiggleFix
+THREADLOCAL int64_t		pixlow; // [crispy] WiggleFix
+THREADLOCAL fixed_t		pixhighstep;
+THREADLOCAL fixed_t		pixlowstep;
 
-int64_t		topfrac; // [crispy] WiggleFix
-fixed_t		topstep;
+THREADLOCAL int64_t		topfrac; // [crispy] WiggleFix
+THREADLOCAL fixed_t		topstep;
 
-int64_t		bottomfrac; // [crispy] WiggleFix
-fixed_t		bottomstep;
+THREADLOCAL int64_t		bottomfrac; // [crispy] WiggleFix
+THREADLOCAL fixed_t		bottomstep;
 
 
-lighttable_t**	walllights;
+THREADLOCAL lighttable_t**	walllights;
 
-int*		maskedtexturecol; // [crispy] 32-bit integer math
+THREADLOCAL int*		maskedtexturecol; // [crispy] 32-bit integer math
 
 
 // [crispy] WiggleFix: add this code block near the top of r_segs.c
@@ -130,10 +130,10 @@ int*		maskedtexturecol; // [crispy] 32-bit integer math
 //   possibly, creating a noticable performance penalty.
 //
 
-static int	max_rwscale = 64 * FRACUNIT;
-static int	heightbits = 12;
-static int	heightunit = (1 << 12);
-static int	invhgtbits = 4;
+static THREADLOCAL int	max_rwscale = 64 * FRACUNIT;
+static THREADLOCAL int	heightbits = 12;
+static THREADLOCAL int	heightunit = (1 << 12);
+static THREADLOCAL int	invhgtbits = 4;
 
 static const struct
 {
@@ -152,7 +152,7 @@ static const struct
 
 void R_FixWiggle (sector_t *sector)
 {
-    static int	lastheight = 0;
+    static THREADLOCAL int	lastheight = 0;
     int		height = (sector->interpceilingheight - sector->interpfloorheight) >> FRACBITS;
 
     // disallow negative heights. using 1 forces cache initialization
@@ -410,7 +410,7 @@ void R_RenderSegLoop (void)
 	    dc_source = R_GetColumn(midtexture,texturecolumn);
 	    dc_texheight = textureheight[midtexture]>>FRACBITS; // [crispy] Tutti-Frutti fix
 	    dc_brightmap = texturebrightmap[midtexture];
-	    colfunc ();
+	    R_BRIGHTMAPPED ? brightcolfunc () : colfunc ();
 	    ceilingclip[rw_x] = viewheight;
 	    floorclip[rw_x] = -1;
 	}
@@ -434,7 +434,7 @@ void R_RenderSegLoop (void)
 		    dc_source = R_GetColumn(toptexture,texturecolumn);
 		    dc_texheight = textureheight[toptexture]>>FRACBITS; // [crispy] Tutti-Frutti fix
 		    dc_brightmap = texturebrightmap[toptexture];
-		    colfunc ();
+		    R_BRIGHTMAPPED ? brightcolfunc () : colfunc ();
 		    ceilingclip[rw_x] = mid;
 		}
 		else
@@ -466,7 +466,7 @@ void R_RenderSegLoop (void)
 					    texturecolumn);
 		    dc_texheight = textureheight[bottomtexture]>>FRACBITS; // [crispy] Tutti-Frutti fix
 		    dc_brightmap = texturebrightmap[bottomtexture];
-		    colfunc ();
+		    R_BRIGHTMAPPED ? brightcolfunc () : colfunc ();
 		    floorclip[rw_x] = mid;
 		}
 		else
@@ -567,6 +567,10 @@ R_StoreWallRange
     if (automapactive && !crispy->automapoverlay)
         return;
 
+    // [crispy] multithreaded rendering: entirely outside of this strip
+    if (stop < viewstripx1 || start > viewstripx2)
+        return;
+
     // calculate rw_distance for scale calculation
     rw_normalangle = curline->r_angle + ANG90; // [crispy] use re-calculated angle
     
@@ -887,6 +891,27 @@ R_StoreWallRange
 	}
     }
     
+    // [crispy] multithreaded rendering: only render the columns inside
+    // this strip, stepping forward to the first one
+    if (rw_x < viewstripx1)
+    {
+	const int64_t skip = viewstripx1 - rw_x;
+
+	rw_scale = (fixed_t)(rw_scale + skip * rw_scalestep);
+	topfrac += skip * topstep;
+	bottomfrac += skip * bottomstep;
+
+	if (toptexture)
+	    pixhigh += skip * pixhighstep;
+	if (bottomtexture)
+	    pixlow += skip * pixlowstep;
+
+	rw_x = start = viewstripx1;
+    }
+
+    if (rw_stopx > viewstripx2 + 1)
+	rw_stopx = viewstripx2 + 1;
+
     // render it
     if (markceiling)
 	ceilingplane = R_CheckPlane (ceilingplane, rw_x, rw_stopx-1);
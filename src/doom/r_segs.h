@@ -23,6 +23,8 @@
 
 
 
+void R_FixWiggle (sector_t *sector);
+
 void
 R_RenderMaskedSegRange
 ( drawseg_t*	ds,
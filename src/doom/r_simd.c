@@ -0,0 +1,333 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[crispy] SSE2/AVX2 column and span drawers for the truecolor renderer.
+//	They produce exactly the same pixels as R_DrawColumn() and
+//	R_DrawSpan(), several at a time, and fall back to those for
+//	the cases they do not handle.
+//
+
+#include "r_simd.h"
+
+#ifdef HAVE_SIMD_DRAWERS
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "SDL.h"
+
+#include "doomdef.h"
+
+#include "i_system.h"
+#include "m_argv.h"
+
+#include "r_local.h"
+
+#include "doomstat.h"
+
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+//
+// Finish a span with the scalar loop, starting at the current
+// ds_xfrac/ds_yfrac position.
+//
+static inline void R_DrawSpanTail (pixel_t *dest, int count)
+{
+    while (count-- > 0)
+    {
+	const byte source = ds_source[((ds_yfrac >> 10) & 0x0fc0) |
+	                              ((ds_xfrac >> 16) & 0x3f)];
+	*dest++ = ds_colormap[ds_brightmap[source]][source];
+
+	ds_xfrac += ds_xstep;
+	ds_yfrac += ds_ystep;
+    }
+}
+
+//
+// R_DrawSpanSSE2
+// Calculates the flat texture offsets of four pixels at once
+// and writes them to the framebuffer with a single store.
+//
+void TARGET_SSE2 R_DrawSpanSSE2 (void)
+{
+    pixel_t *dest;
+    int count;
+
+    // mirrored levels draw the span from right to left
+    if (crispy->fliplevels)
+    {
+	R_DrawSpan();
+	return;
+    }
+
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1 + 1;
+
+    if (count >= 4)
+    {
+	const unsigned int xstep = ds_xstep, ystep = ds_ystep;
+	const unsigned int xfrac = ds_xfrac, yfrac = ds_yfrac;
+	const __m128i xstep4 = _mm_set1_epi32(xstep * 4);
+	const __m128i ystep4 = _mm_set1_epi32(ystep * 4);
+	const __m128i xmask = _mm_set1_epi32(0x3f);
+	const __m128i ymask = _mm_set1_epi32(0x0fc0);
+	__m128i xfrac4 = _mm_setr_epi32(xfrac, xfrac + xstep,
+	                                xfrac + xstep * 2, xfrac + xstep * 3);
+	__m128i yfrac4 = _mm_setr_epi32(yfrac, yfrac + ystep,
+	                                yfrac + ystep * 2, yfrac + ystep * 3);
+
+	do
+	{
+	    union { __m128i v; int i[4]; } spot;
+	    byte s0, s1, s2, s3;
+
+	    spot.v = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(yfrac4, 10), ymask),
+	                          _mm_and_si128(_mm_srli_epi32(xfrac4, 16), xmask));
+
+	    s0 = ds_source[spot.i[0]];
+	    s1 = ds_source[spot.i[1]];
+	    s2 = ds_source[spot.i[2]];
+	    s3 = ds_source[spot.i[3]];
+
+	    _mm_storeu_si128((__m128i *) dest,
+	                     _mm_setr_epi32(ds_colormap[ds_brightmap[s0]][s0],
+	                                    ds_colormap[ds_brightmap[s1]][s1],
+	                                    ds_colormap[ds_brightmap[s2]][s2],
+	                                    ds_colormap[ds_brightmap[s3]][s3]));
+
+	    xfrac4 = _mm_add_epi32(xfrac4, xstep4);
+	    yfrac4 = _mm_add_epi32(yfrac4, ystep4);
+	    dest += 4;
+	    count -= 4;
+	} while (count >= 4);
+
+	ds_xfrac = _mm_cvtsi128_si32(xfrac4);
+	ds_yfrac = _mm_cvtsi128_si32(yfrac4);
+    }
+
+    R_DrawSpanTail(dest, count);
+}
+
+//
+// Gathers eight bytes from a byte array. AVX2 can only gather 32-bit
+// words, so each lane loads the aligned word that holds its byte and
+// shifts the byte down. An aligned word never straddles a page, so
+// this can not fault where the plain byte load would not.
+//
+static inline __m256i TARGET_AVX2 GatherBytes (const byte *base, __m256i index)
+{
+    const uintptr_t misalign = (uintptr_t) base & 3;
+    const int *words = (const int *) (base - misalign);
+    const __m256i offset = _mm256_add_epi32(index, _mm256_set1_epi32((int) misalign));
+    const __m256i word = _mm256_i32gather_epi32(words, _mm256_srli_epi32(offset, 2), 4);
+    const __m256i shift = _mm256_slli_epi32(_mm256_and_si256(offset, _mm256_set1_epi32(3)), 3);
+
+    return _mm256_and_si256(_mm256_srlv_epi32(word, shift), _mm256_set1_epi32(0xff));
+}
+
+//
+// Looks up eight texels in the colormap pair, i.e. the vector version
+// of colormap[brightmap[source]][source].
+//
+static inline __m256i TARGET_AVX2 GatherColors (lighttable_t *const colormap[2],
+                                                const byte *brightmap, __m256i source)
+{
+    const __m256i bright = _mm256_cmpgt_epi32(GatherBytes(brightmap, source),
+                                              _mm256_setzero_si256());
+    const __m256i dark = _mm256_i32gather_epi32((const int *) colormap[0], source, 4);
+
+    // only the brightmapped lanes are loaded from the second colormap
+    return _mm256_mask_i32gather_epi32(dark, (const int *) colormap[1], source, bright, 4);
+}
+
+//
+// R_DrawSpanAVX2
+// Draws eight pixels per iteration, with all texture and
+// colormap lookups done by vector gathers.
+//
+void TARGET_AVX2 R_DrawSpanAVX2 (void)
+{
+    pixel_t *dest;
+    int count;
+
+    if (crispy->fliplevels)
+    {
+	R_DrawSpan();
+	return;
+    }
+
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1 + 1;
+
+    if (count >= 8)
+    {
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i xstep8 = _mm256_set1_epi32((int) ((unsigned int) ds_xstep * 8));
+	const __m256i ystep8 = _mm256_set1_epi32((int) ((unsigned int) ds_ystep * 8));
+	const __m256i xmask = _mm256_set1_epi32(0x3f);
+	const __m256i ymask = _mm256_set1_epi32(0x0fc0);
+	__m256i xfrac8 = _mm256_add_epi32(_mm256_set1_epi32(ds_xfrac),
+	                                  _mm256_mullo_epi32(lane, _mm256_set1_epi32(ds_xstep)));
+	__m256i yfrac8 = _mm256_add_epi32(_mm256_set1_epi32(ds_yfrac),
+	                                  _mm256_mullo_epi32(lane, _mm256_set1_epi32(ds_ystep)));
+
+	do
+	{
+	    const __m256i spot = _mm256_or_si256(
+	        _mm256_and_si256(_mm256_srli_epi32(yfrac8, 10), ymask),
+	        _mm256_and_si256(_mm256_srli_epi32(xfrac8, 16), xmask));
+	    const __m256i source = GatherBytes(ds_source, spot);
+
+	    _mm256_storeu_si256((__m256i *) dest,
+	                        GatherColors(ds_colormap, ds_brightmap, source));
+
+	    xfrac8 = _mm256_add_epi32(xfrac8, xstep8);
+	    yfrac8 = _mm256_add_epi32(yfrac8, ystep8);
+	    dest += 8;
+	    count -= 8;
+	} while (count >= 8);
+
+	ds_xfrac = _mm_cvtsi128_si32(_mm256_castsi256_si128(xfrac8));
+	ds_yfrac = _mm_cvtsi128_si32(_mm256_castsi256_si128(yfrac8));
+    }
+
+    R_DrawSpanTail(dest, count);
+}
+
+//
+// R_DrawColumnAVX2
+// Looks up eight texels of a column at once. The pixels are a screen
+// row apart, so they are still written one by one. Textures that are
+// not a power of two high need the wrap-around of R_DrawColumn().
+//
+void TARGET_AVX2 R_DrawColumnAVX2 (void)
+{
+    pixel_t *dest;
+    int count;
+    fixed_t frac, fracstep;
+    const int heightmask = dc_texheight - 1;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count < 8 || (dc_texheight & heightmask) || (unsigned int) heightmask > 0xffff)
+    {
+	R_DrawColumn();
+	return;
+    }
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT)
+	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[flipviewwidth[dc_x]];
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    {
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i step8 = _mm256_set1_epi32((int) ((unsigned int) fracstep * 8));
+	const __m256i mask = _mm256_set1_epi32(heightmask);
+	__m256i frac8 = _mm256_add_epi32(_mm256_set1_epi32(frac),
+	                                 _mm256_mullo_epi32(lane, _mm256_set1_epi32(fracstep)));
+
+	do
+	{
+	    const __m256i index = _mm256_and_si256(_mm256_srli_epi32(frac8, FRACBITS), mask);
+	    union { __m256i v; pixel_t p[8]; } pixels;
+
+	    pixels.v = GatherColors(dc_colormap, dc_brightmap, GatherBytes(dc_source, index));
+
+	    dest[0 * SCREENWIDTH] = pixels.p[0];
+	    dest[1 * SCREENWIDTH] = pixels.p[1];
+	    dest[2 * SCREENWIDTH] = pixels.p[2];
+	    dest[3 * SCREENWIDTH] = pixels.p[3];
+	    dest[4 * SCREENWIDTH] = pixels.p[4];
+	    dest[5 * SCREENWIDTH] = pixels.p[5];
+	    dest[6 * SCREENWIDTH] = pixels.p[6];
+	    dest[7 * SCREENWIDTH] = pixels.p[7];
+
+	    frac8 = _mm256_add_epi32(frac8, step8);
+	    dest += 8 * SCREENWIDTH;
+	    count -= 8;
+	} while (count >= 8);
+
+	frac = _mm_cvtsi128_si32(_mm256_castsi256_si128(frac8));
+    }
+
+    while (count-- > 0)
+    {
+	const byte source = dc_source[(frac>>FRACBITS)&heightmask];
+	*dest = dc_colormap[dc_brightmap[source]][source];
+
+	dest += SCREENWIDTH;
+	frac += fracstep;
+    }
+}
+
+void R_SelectSIMDDrawers (void (**column) (void), void (**span) (void))
+{
+    static int simd = -1;
+
+    if (simd < 0)
+    {
+	//!
+	// @category video
+	//
+	// Disable the SSE2/AVX2 column and span drawers of the
+	// truecolor renderer and the AVX2 palette conversion of the
+	// paletted renderer.
+	//
+
+	if (M_ParmExists("-nosimd"))
+	{
+	    simd = 0;
+	}
+	else if (SDL_HasAVX2())
+	{
+	    simd = 2;
+	}
+	else if (SDL_HasSSE2())
+	{
+	    simd = 1;
+	}
+	else
+	{
+	    simd = 0;
+	}
+    }
+
+    if (simd == 2)
+    {
+	*column = R_DrawColumnAVX2;
+	*span = R_DrawSpanAVX2;
+    }
+    else if (simd == 1)
+    {
+	*span = R_DrawSpanSSE2;
+    }
+}
+
+#endif
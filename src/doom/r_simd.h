@@ -0,0 +1,39 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	[crispy] SSE2/AVX2 column and span drawers for the truecolor renderer
+//
+
+#ifndef __R_SIMD__
+#define __R_SIMD__
+
+#if defined(CRISPY_TRUECOLOR) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define HAVE_SIMD_DRAWERS
+#endif
+
+#ifdef HAVE_SIMD_DRAWERS
+
+void R_DrawColumnAVX2 (void);
+void R_DrawSpanSSE2 (void);
+void R_DrawSpanAVX2 (void);
+
+// Replaces the given high-detail drawers with the fastest
+// vectorized versions that the CPU supports.
+void R_SelectSIMDDrawers (void (**column) (void), void (**span) (void));
+
+#endif
+
+#endif
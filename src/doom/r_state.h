@@ -113,19 +113,19 @@ extern int		viewangletox[FINEANGLES/2];
 extern angle_t		xtoviewangle[MAXWIDTH+1];
 //extern fixed_t		finetangent[FINEANGLES/2];
 
-extern fixed_t		rw_distance;
-extern angle_t		rw_normalangle;
+extern THREADLOCAL fixed_t		rw_distance;
+extern THREADLOCAL angle_t		rw_normalangle;
 
 
 
 // angle to line origin
-extern int		rw_angle1;
+extern THREADLOCAL int		rw_angle1;
 
 // Segs count?
-extern int		sscount;
+extern THREADLOCAL int		sscount;
 
-extern visplane_t*	floorplane;
-extern visplane_t*	ceilingplane;
+extern THREADLOCAL visplane_t*	floorplane;
+extern THREADLOCAL visplane_t*	ceilingplane;
 
 
 #endif
@@ -39,7 +39,7 @@
 #define FLATSIZE (64 * 64)
 
 static int *offsets;
-static int *offset;
+static THREADLOCAL int *offset;
 
 #define AMP 2
 #define AMP2 2
@@ -91,9 +91,9 @@ void R_InitDistortedFlats()
 
 char *R_DistortedFlat(int flatnum)
 {
-	static int swirltic = -1;
-	static int swirlflat = -1;
-	static char distortedflat[FLATSIZE];
+	static THREADLOCAL int swirltic = -1;
+	static THREADLOCAL int swirlflat = -1;
+	static THREADLOCAL char distortedflat[FLATSIZE];
 
 	if (swirltic != leveltime)
 	{
@@ -83,7 +83,7 @@ laserpatch_t *laserpatch = laserpatch_m;
 fixed_t		pspritescale;
 fixed_t		pspriteiscale;
 
-lighttable_t**	spritelights;
+THREADLOCAL lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
@@ -323,10 +323,13 @@ void R_InitSpriteDefs(const char **namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t*	vissprites = NULL;
-vissprite_t*	vissprite_p;
+THREADLOCAL vissprite_t*	vissprites = NULL;
+THREADLOCAL vissprite_t*	vissprite_p;
 int		newvissprite;
-static int	numvissprites;
+static THREADLOCAL int	numvissprites;
+
+static THREADLOCAL byte*	sectormarks;
+static THREADLOCAL int	numsectormarks;
 
 
 
@@ -355,13 +358,26 @@ void R_InitSprites(const char **namelist)
 void R_ClearSprites (void)
 {
     vissprite_p = vissprites;
+
+    // [crispy] multithreaded rendering: each render thread keeps track
+    // of the sectors it has already added the sprites of on its own
+    if (numrenderthreads > 1)
+    {
+	if (numsectormarks < numsectors)
+	{
+	    sectormarks = I_Realloc(sectormarks, numsectors * sizeof(*sectormarks));
+	    numsectormarks = numsectors;
+	}
+
+	memset(sectormarks, 0, numsectors * sizeof(*sectormarks));
+    }
 }
 
 
 //
 // R_NewVisSprite
 //
-vissprite_t	overflowsprite;
+THREADLOCAL vissprite_t	overflowsprite;
 
 vissprite_t* R_NewVisSprite (void)
 {
@@ -403,11 +419,11 @@ vissprite_t* R_NewVisSprite (void)
 // Masked means: partly transparent, i.e. stored
 //  in posts/runs of opaque pixels.
 //
-int*		mfloorclip; // [crispy] 32-bit integer math
-int*		mceilingclip; // [crispy] 32-bit integer math
+THREADLOCAL int*		mfloorclip; // [crispy] 32-bit integer math
+THREADLOCAL int*		mceilingclip; // [crispy] 32-bit integer math
 
-fixed_t		spryscale;
-int64_t		sprtopscreen; // [crispy] WiggleFix
+THREADLOCAL fixed_t		spryscale;
+THREADLOCAL int64_t		sprtopscreen; // [crispy] WiggleFix
 
 void R_DrawMaskedColumn (column_t* column)
 {
@@ -477,7 +493,9 @@ R_DrawVisSprite
     patch_t*		patch;
 	
 	
+    R_LockRenderCache();
     patch = W_CacheLumpNum (vis->patch+firstspritelump, PU_CACHE);
+    R_UnlockRenderCache();
 
     // [crispy] brightmaps for select sprites
     dc_colormap[0] = vis->colormap[0];
@@ -514,6 +532,12 @@ R_DrawVisSprite
 	blendfunc = vis->blendfunc;
 #endif
     }
+
+    // [crispy] opaque sprites with brightmaps
+    if (colfunc == basecolfunc && R_BRIGHTMAPPED)
+    {
+	colfunc = brightcolfunc;
+    }
 	
     dc_iscale = abs(vis->xiscale)>>detailshift;
     dc_texturemid = vis->texturemid;
@@ -724,6 +748,12 @@ void R_ProjectSprite (mobj_t* thing)
 	return;
     }
 
+    // [crispy] multithreaded rendering: outside of this strip
+    if (x1 > viewstripx2 || x2 < viewstripx1)
+    {
+	return;
+    }
+
     // store information in a vissprite
     vis = R_NewVisSprite ();
     vis->translation = NULL; // [crispy] no color translation
@@ -734,8 +764,8 @@ void R_ProjectSprite (mobj_t* thing)
     vis->gz = interpz;
     vis->gzt = gzt; // [JN] killough 3/27/98
     vis->texturemid = gzt - viewz;
-    vis->x1 = x1 < 0 ? 0 : x1;
-    vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
+    vis->x1 = x1 < viewstripx1 ? viewstripx1 : x1;
+    vis->x2 = x2 > viewstripx2 ? viewstripx2 : x2;
     iscale = FixedDiv (FRACUNIT, xscale);
 
     if (flip)
@@ -945,11 +975,24 @@ void R_AddSprites (sector_t* sec)
     // A sector might have been split into several
     //  subsectors during BSP building.
     // Thus we check whether its already added.
-    if (sec->validcount == validcount)
-	return;		
+    if (numrenderthreads > 1)
+    {
+	// [crispy] sectors are shared between the render threads
+	const int secnum = sec - sectors;
+
+	if (sectormarks[secnum])
+	    return;
+
+	sectormarks[secnum] = 1;
+    }
+    else
+    {
+	if (sec->validcount == validcount)
+	    return;
 
-    // Well, now it will be done.
-    sec->validcount = validcount;
+	// Well, now it will be done.
+	sec->validcount = validcount;
+    }
 	
     lightnum = (sec->rlightlevel >> LIGHTSEGSHIFT)+(extralight * LIGHTBRIGHT); // [crispy] A11Y
 
@@ -1165,63 +1208,164 @@ void R_SortVisSprites (void)
     qsort(vissprites, count, sizeof(*vissprites), cmp_vissprites);
 }
 #else
-vissprite_t	vsprsortedhead;
+THREADLOCAL vissprite_t	vsprsortedhead;
+
+
+// [crispy] stable LSD radix sort on the scale, 8 bits per pass,
+// through a reusable buffer of sort keys
+typedef struct
+{
+    unsigned int key;
+    int index;
+} vsprsortkey_t;
 
+static THREADLOCAL vsprsortkey_t *vsprsortkeys;
+static THREADLOCAL int numvsprsortkeys;
 
 void R_SortVisSprites (void)
 {
     int			i;
     int			count;
+    int			shift;
+    unsigned int	counts[256];
+    unsigned int	offset, digit;
+    vsprsortkey_t*	src;
+    vsprsortkey_t*	dst;
+    vsprsortkey_t*	tmp;
     vissprite_t*	ds;
-    vissprite_t*	best;
-    vissprite_t		unsorted;
-    fixed_t		bestscale;
 
     count = vissprite_p - vissprites;
-	
-    unsorted.next = unsorted.prev = &unsorted;
 
     if (!count)
 	return;
-		
-    for (ds=vissprites ; ds<vissprite_p ; ds++)
+
+    if (numvsprsortkeys < count)
     {
-	ds->next = ds+1;
-	ds->prev = ds-1;
+	numvsprsortkeys = numvissprites;
+	vsprsortkeys = I_Realloc(vsprsortkeys, 2 * numvsprsortkeys * sizeof(*vsprsortkeys));
     }
-    
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
-    
-    // pull the vissprites out by scale
 
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
-    for (i=0 ; i<count ; i++)
+    src = vsprsortkeys;
+    dst = vsprsortkeys + numvsprsortkeys;
+
+    // flip the sign bit, so that the keys sort as unsigned integers
+    for (i = 0; i < count; i++)
     {
-	bestscale = INT_MAX;
-        best = unsorted.next;
-	for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
+	src[i].key = (unsigned int) vissprites[i].scale ^ 0x80000000u;
+	src[i].index = i;
+    }
+
+    for (shift = 0; shift < 32; shift += 8)
+    {
+	memset(counts, 0, sizeof(counts));
+
+	for (i = 0; i < count; i++)
 	{
-	    if (ds->scale < bestscale)
-	    {
-		bestscale = ds->scale;
-		best = ds;
-	    }
+	    counts[(src[i].key >> shift) & 0xff]++;
+	}
+
+	// skip the pass if all keys have the same digit here,
+	// which usually is the case for the most significant ones
+	if (counts[(src[0].key >> shift) & 0xff] == (unsigned int) count)
+	{
+	    continue;
+	}
+
+	for (digit = 0, offset = 0; digit < 256; digit++)
+	{
+	    const unsigned int n = counts[digit];
+
+	    counts[digit] = offset;
+	    offset += n;
 	}
-	best->next->prev = best->prev;
-	best->prev->next = best->next;
-	best->next = &vsprsortedhead;
-	best->prev = vsprsortedhead.prev;
-	vsprsortedhead.prev->next = best;
-	vsprsortedhead.prev = best;
+
+	for (i = 0; i < count; i++)
+	{
+	    dst[counts[(src[i].key >> shift) & 0xff]++] = src[i];
+	}
+
+	tmp = src;
+	src = dst;
+	dst = tmp;
+    }
+
+    // link the vissprites up in sorted order
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+    for (i = 0; i < count; i++)
+    {
+	ds = &vissprites[src[i].index];
+	ds->next = &vsprsortedhead;
+	ds->prev = vsprsortedhead.prev;
+	vsprsortedhead.prev->next = ds;
+	vsprsortedhead.prev = ds;
     }
 }
 #endif
 
 
 
+//
+// R_IndexDrawSegs
+// [crispy] The view is split up into a binary tree of column ranges,
+// DSINDEXLEVELS deep. Every node of it lists the drawsegs overlapping its
+// columns, in the order R_DrawSprite() scans them in, so that a sprite
+// only needs to look at the drawsegs of the smallest node it fits into.
+//
+#define DSINDEXLEVELS	4
+#define DSINDEXNODES	((1 << DSINDEXLEVELS) - 1)
+#define DSINDEXNODE(level, x) (((x) << (level)) / viewwidth)
+
+typedef struct
+{
+    int x1, x2;
+    drawseg_t *ds;
+} drawsegrange_t;
+
+static THREADLOCAL drawsegrange_t *dsindex[DSINDEXNODES];
+static THREADLOCAL int dsindexcount[DSINDEXNODES];
+static THREADLOCAL int numdsindex;
+
+static void R_IndexDrawSegs (void)
+{
+    drawseg_t *ds;
+    int level, node, last, i;
+
+    if (numdsindex < numdrawsegs)
+    {
+	numdsindex = numdrawsegs;
+
+	for (i = 0; i < DSINDEXNODES; i++)
+	{
+	    dsindex[i] = I_Realloc(dsindex[i], numdsindex * sizeof(**dsindex));
+	}
+    }
+
+    memset(dsindexcount, 0, sizeof(dsindexcount));
+
+    for (ds = ds_p - 1; ds >= drawsegs; ds--)
+    {
+	if (!ds->silhouette && !ds->maskedtexturecol)
+	{
+	    continue;
+	}
+
+	for (level = 0; level < DSINDEXLEVELS; level++)
+	{
+	    last = (1 << level) - 1 + DSINDEXNODE(level, ds->x2);
+
+	    for (node = (1 << level) - 1 + DSINDEXNODE(level, ds->x1);
+	         node <= last; node++)
+	    {
+		drawsegrange_t *const range = &dsindex[node][dsindexcount[node]++];
+
+		range->x1 = ds->x1;
+		range->x2 = ds->x2;
+		range->ds = ds;
+	    }
+	}
+    }
+}
+
 //
 // R_DrawSprite
 //
@@ -1236,24 +1380,38 @@ void R_DrawSprite (vissprite_t* spr)
     fixed_t		scale;
     fixed_t		lowscale;
     int			silhouette;
+    int			level, node, i;
 		
     for (x = spr->x1 ; x<=spr->x2 ; x++)
 	clipbot[x] = cliptop[x] = -2;
     
+    // [crispy] find the smallest node of the drawseg index
+    // that holds all of the sprite's columns
+    for (level = DSINDEXLEVELS - 1; level > 0; level--)
+    {
+	if (DSINDEXNODE(level, spr->x1) == DSINDEXNODE(level, spr->x2))
+	    break;
+    }
+    node = (1 << level) - 1 + DSINDEXNODE(level, spr->x1);
+
     // Scan drawsegs from end to start for obscuring segs.
     // The first drawseg that has a greater scale
     //  is the clip seg.
-    for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
+    for (i = 0; i < dsindexcount[node]; i++)
     {
+	const drawsegrange_t *const range = &dsindex[node][i];
+
 	// determine if the drawseg obscures the sprite
-	if (ds->x1 > spr->x2
-	    || ds->x2 < spr->x1
-	    || (!ds->silhouette
-		&& !ds->maskedtexturecol) )
+	// [crispy] drawsegs without silhouette or masked texture
+	// are not in the index at all
+	if (range->x1 > spr->x2
+	    || range->x2 < spr->x1)
 	{
 	    // does not cover sprite
 	    continue;
 	}
+
+	ds = range->ds;
 			
 	r1 = ds->x1 < spr->x1 ? spr->x1 : ds->x1;
 	r2 = ds->x2 > spr->x2 ? spr->x2 : ds->x2;
@@ -1350,6 +1508,8 @@ void R_DrawMasked (void)
 
     if (vissprite_p > vissprites)
     {
+	R_IndexDrawSegs ();
+
 	// draw all vissprites back to front
 #ifdef HAVE_QSORT
 	for (spr = vissprites;
@@ -1367,17 +1527,11 @@ void R_DrawMasked (void)
     }
     
     // render any remaining masked mid textures
+    // [crispy] only inside of this strip
     for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
 	if (ds->maskedtexturecol)
-	    R_RenderMaskedSegRange (ds, ds->x1, ds->x2);
-    
-    if (crispy->cleanscreenshot == 2)
-        return;
-
-    // draw the psprites on top of everything
-    //  but does not draw on side views
-    if (!viewangleoffset)		
-	R_DrawPlayerSprites ();
+	    R_RenderMaskedSegRange (ds, MAX(ds->x1, viewstripx1),
+	                                MIN(ds->x2, viewstripx2));
 }
 
 
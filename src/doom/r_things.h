@@ -24,9 +24,9 @@
 
 #define MAXVISSPRITES  	128
 
-extern vissprite_t*	vissprites;
-extern vissprite_t*	vissprite_p;
-extern vissprite_t	vsprsortedhead;
+extern THREADLOCAL vissprite_t*	vissprites;
+extern THREADLOCAL vissprite_t*	vissprite_p;
+extern THREADLOCAL vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
@@ -34,10 +34,10 @@ extern int		negonearray[MAXWIDTH]; // [crispy] 32-bit integer math
 extern int		screenheightarray[MAXWIDTH]; // [crispy] 32-bit integer math
 
 // vars for R_DrawMaskedColumn
-extern int*		mfloorclip; // [crispy] 32-bit integer math
-extern int*		mceilingclip; // [crispy] 32-bit integer math
-extern fixed_t		spryscale;
-extern int64_t		sprtopscreen; // [crispy] WiggleFix
+extern THREADLOCAL int*		mfloorclip; // [crispy] 32-bit integer math
+extern THREADLOCAL int*		mceilingclip; // [crispy] 32-bit integer math
+extern THREADLOCAL fixed_t		spryscale;
+extern THREADLOCAL int64_t		sprtopscreen; // [crispy] WiggleFix
 
 extern fixed_t		pspritescale;
 extern fixed_t		pspriteiscale;
@@ -54,6 +54,7 @@ void R_DrawSprites (void);
 void R_InitSprites(const char **namelist);
 void R_ClearSprites (void);
 void R_DrawMasked (void);
+void R_DrawPlayerSprites (void);
 
 void
 R_ClipVisSprite
@@ -1175,7 +1175,8 @@ ST_Responder (event_t* ev)
     if (cht_CheckCheat(&cheat_showfps, ev->data2) ||
              cht_CheckCheat(&cheat_showfps2, ev->data2))
     {
-	plyr->powers[pw_showfps] ^= 1;
+	// [crispy] cycle FPS counter, FPS counter with frame profile, off
+	plyr->powers[pw_showfps] = (plyr->powers[pw_showfps] + 1) % 3;
     }
     // [crispy] implement Boom's "tnthom" cheat
     else if (cht_CheckCheat(&cheat_hom, ev->data2))
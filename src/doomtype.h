@@ -68,12 +68,15 @@
 #define PRINTF_ATTR(fmt, first) __attribute__((format(printf, fmt, first)))
 #define PRINTF_ARG_ATTR(x) __attribute__((format_arg(x)))
 #define NORETURN __attribute__((noreturn))
+#define THREADLOCAL __thread
 
 #else
 #if defined(_MSC_VER)
 #define PACKEDATTR __pragma(pack(pop))
+#define THREADLOCAL __declspec(thread)
 #else
 #define PACKEDATTR
+#define THREADLOCAL _Thread_local
 #endif
 #define PRINTF_ATTR(fmt, first)
 #define PRINTF_ARG_ATTR(x)
@@ -0,0 +1,644 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      [crispy] Real-time video and audio capture. The main thread
+//      copies each presented frame into a ring of preallocated
+//      buffers, and a writer thread converts and streams them out.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_mixer.h"
+
+#include "i_capture.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define PIPE_MODE "wb"
+#define NULL_DEVICE "NUL"
+#else
+#define PIPE_MODE "w"
+#define NULL_DEVICE "/dev/null"
+#endif
+
+// Number of frames that may be queued up for the writer thread. The
+// main thread waits for a free buffer rather than dropping a frame.
+#define NUMCAPTUREBUFFERS 8
+
+// Size of the ring that the mixed sound is passed on in, in bytes.
+#define AUDIORINGSIZE (1 << 20)
+
+#define WAVHEADERSIZE 44
+
+boolean capturing = false;
+
+typedef struct
+{
+    byte *pixels;
+    byte palette[256 * 4];
+    byte tint[4];
+    boolean tinted;
+    int repeat;       // number of output frames to fill with this one
+} captureframe_t;
+
+static captureframe_t frames[NUMCAPTUREBUFFERS];
+static int nextframe, writeframe;
+
+static int capturewidth, captureheight, capturefps = 60;
+static uint32_t captureformat;
+static int bytesperpixel;
+static boolean y4m;
+
+static FILE *videofile = NULL;
+static boolean videopipe;
+static byte *rgbbuffer, *yuvbuffer;
+static boolean headerwritten;
+
+static uint64_t capturestart;
+static uint64_t outputframes;
+
+static SDL_Thread *writerthread;
+static SDL_sem *freeframes, *fullframes;
+static boolean stopping;
+static boolean writeerror;
+
+static FILE *audiofile = NULL;
+static byte *audioring;
+static SDL_atomic_t audiohead, audiotail;
+static uint32_t audiobytes, audiodropped;
+static int audiofreq, audiochannels;
+static Uint16 audioformat;
+
+// Batch rendering: the game runs on a virtual clock, and the sound is
+// mixed in step with it. The main thread holds the lock of the audio
+// device and only releases it to let the sound catch up.
+static boolean batch;
+static SDL_AudioDeviceID audiodevice;
+static SDL_sem *audioready;
+static uint64_t audiomixed;
+
+static void WriteVideo(const void *data, size_t size)
+{
+    if (!writeerror && fwrite(data, 1, size, videofile) != size)
+    {
+        writeerror = true;
+    }
+}
+
+//
+// Convert a captured frame to 24-bit RGB, with the tint blended in.
+//
+static void ConvertFrame(const captureframe_t *frame)
+{
+    const int count = capturewidth * captureheight;
+    byte *dest = rgbbuffer;
+    int i;
+
+    if (bytesperpixel == 1)
+    {
+        const byte *src = frame->pixels;
+
+        for (i = 0; i < count; i++)
+        {
+            const byte *color = &frame->palette[*src++ * 4];
+
+            *dest++ = color[0];
+            *dest++ = color[1];
+            *dest++ = color[2];
+        }
+    }
+    else
+    {
+        SDL_ConvertPixels(capturewidth, captureheight,
+                          captureformat, frame->pixels, capturewidth * bytesperpixel,
+                          SDL_PIXELFORMAT_RGB24, rgbbuffer, capturewidth * 3);
+    }
+
+    if (frame->tinted)
+    {
+        const int alpha = frame->tint[3];
+
+        dest = rgbbuffer;
+
+        for (i = 0; i < count * 3; i++)
+        {
+            const int c = dest[i];
+
+            dest[i] = c + (frame->tint[i % 3] - c) * alpha / 255;
+        }
+    }
+}
+
+//
+// Convert rgbbuffer to full range BT.601 Y'CbCr 4:4:4 planes.
+//
+static void ConvertToYUV(void)
+{
+    const int count = capturewidth * captureheight;
+    const byte *src = rgbbuffer;
+    byte *y = yuvbuffer, *u = y + count, *v = u + count;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        const int r = src[0], g = src[1], b = src[2];
+
+        y[i] = (77 * r + 150 * g + 29 * b + 128) >> 8;
+        u[i] = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+        v[i] = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+        src += 3;
+    }
+}
+
+static void WriteFrame(const captureframe_t *frame)
+{
+    const int count = capturewidth * captureheight;
+    int i;
+
+    if (!headerwritten)
+    {
+        if (y4m)
+        {
+            char header[128];
+
+            // Doom's pixels are 5:6, to fill a 4:3 screen at 320x200
+            M_snprintf(header, sizeof(header),
+                       "YUV4MPEG2 W%d H%d F%d:1 Ip A5:6 C444 XCOLORRANGE=FULL\n",
+                       capturewidth, captureheight, capturefps);
+            WriteVideo(header, strlen(header));
+        }
+
+        headerwritten = true;
+    }
+
+    ConvertFrame(frame);
+
+    if (y4m)
+    {
+        ConvertToYUV();
+    }
+
+    for (i = 0; i < frame->repeat; i++)
+    {
+        if (y4m)
+        {
+            WriteVideo("FRAME\n", 6);
+            WriteVideo(yuvbuffer, count * 3);
+        }
+        else
+        {
+            WriteVideo(rgbbuffer, count * 3);
+        }
+    }
+}
+
+//
+// Audio
+//
+
+// Called by SDL_mixer on the audio thread with each mixed chunk.
+static void AudioTap(void *udata, Uint8 *stream, int len)
+{
+    const int head = SDL_AtomicGet(&audiohead);
+    const int tail = SDL_AtomicGet(&audiotail);
+    const int space = AUDIORINGSIZE - 1 - ((head - tail) & (AUDIORINGSIZE - 1));
+    int first;
+
+    if (batch)
+    {
+        audiomixed += len;
+        SDL_SemPost(audioready);
+    }
+
+    if (len > space)
+    {
+        audiodropped += len;
+        return;
+    }
+
+    first = len < AUDIORINGSIZE - head ? len : AUDIORINGSIZE - head;
+    memcpy(audioring + head, stream, first);
+    memcpy(audioring, stream + first, len - first);
+
+    SDL_AtomicSet(&audiohead, (head + len) & (AUDIORINGSIZE - 1));
+}
+
+static void WriteAudio(void)
+{
+    const int head = SDL_AtomicGet(&audiohead);
+    int tail = SDL_AtomicGet(&audiotail);
+
+    while (tail != head)
+    {
+        const int count = head > tail ? head - tail : AUDIORINGSIZE - tail;
+
+        if (fwrite(audioring + tail, 1, count, audiofile) != (size_t) count)
+        {
+            writeerror = true;
+        }
+
+        audiobytes += count;
+        tail = (tail + count) & (AUDIORINGSIZE - 1);
+    }
+
+    SDL_AtomicSet(&audiotail, tail);
+}
+
+static void PutLong(byte *p, uint32_t value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+}
+
+static void PutShort(byte *p, int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+}
+
+static void WriteWAVHeader(uint32_t datasize)
+{
+    const int bits = SDL_AUDIO_BITSIZE(audioformat);
+    byte header[WAVHEADERSIZE];
+
+    memcpy(header, "RIFF", 4);
+    PutLong(header + 4, 36 + datasize);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    PutLong(header + 16, 16);
+    PutShort(header + 20, SDL_AUDIO_ISFLOAT(audioformat) ? 3 : 1);
+    PutShort(header + 22, audiochannels);
+    PutLong(header + 24, audiofreq);
+    PutLong(header + 28, audiofreq * audiochannels * bits / 8);
+    PutShort(header + 32, audiochannels * bits / 8);
+    PutShort(header + 34, bits);
+    memcpy(header + 36, "data", 4);
+    PutLong(header + 40, datasize);
+
+    fwrite(header, 1, sizeof(header), audiofile);
+}
+
+static int WriterThread(void *unused)
+{
+    for (;;)
+    {
+        // wake up regularly to pass on the sound, too
+        if (SDL_SemWaitTimeout(fullframes, 10) == 0)
+        {
+            WriteFrame(&frames[writeframe]);
+            writeframe = (writeframe + 1) % NUMCAPTUREBUFFERS;
+            SDL_SemPost(freeframes);
+        }
+        else if (stopping)
+        {
+            break;
+        }
+
+        if (audiofile)
+        {
+            WriteAudio();
+        }
+    }
+
+    return 0;
+}
+
+static void I_StopCapture(void)
+{
+    if (!capturing)
+    {
+        return;
+    }
+
+    capturing = false;
+
+    if (audiofile)
+    {
+        Mix_SetPostMix(NULL, NULL);
+    }
+
+    if (audiodevice)
+    {
+        SDL_UnlockAudioDevice(audiodevice);
+        audiodevice = 0;
+    }
+
+    stopping = true;
+    SDL_WaitThread(writerthread, NULL);
+
+    if (videopipe)
+    {
+        pclose(videofile);
+    }
+    else
+    {
+        fclose(videofile);
+    }
+
+    if (audiofile)
+    {
+        WriteAudio();
+
+        // fill in the sizes, now that they are known
+        if (fseek(audiofile, 0, SEEK_SET) == 0)
+        {
+            WriteWAVHeader(audiobytes);
+        }
+
+        fclose(audiofile);
+
+        if (audiodropped > 0)
+        {
+            fprintf(stderr, "I_StopCapture: Dropped %u bytes of sound.\n",
+                    audiodropped);
+        }
+    }
+
+    if (writeerror)
+    {
+        fprintf(stderr, "I_StopCapture: Error while writing the capture.\n");
+    }
+
+    printf("I_StopCapture: Captured %" PRIu64 " frames.\n", outputframes);
+}
+
+void I_CaptureCheckCommandLine(void)
+{
+    int p;
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Frame rate of the video recorded with -capture. The default
+    // is 60.
+    //
+
+    p = M_CheckParmWithArgs("-capturefps", 1);
+
+    if (p > 0)
+    {
+        capturefps = atoi(myargv[p + 1]);
+
+        if (capturefps < 1)
+        {
+            I_Error("I_CaptureCheckCommandLine: Invalid frame rate: %s",
+                    myargv[p + 1]);
+        }
+    }
+
+    // With -headless, there is no need to keep up with the wall clock.
+    // Render and mix as fast as possible, e.g. to convert a demo with
+    // -playdemo into a video.
+    if (M_CheckParmWithArgs("-capture", 1) && M_ParmExists("-headless"))
+    {
+        batch = true;
+        I_SetVirtualClock(capturefps);
+
+        // mix into the void, without waiting for a sound card
+        SDL_setenv("SDL_AUDIODRIVER", "disk", 1);
+        SDL_setenv("SDL_DISKAUDIOFILE", NULL_DEVICE, 1);
+        SDL_setenv("SDL_DISKAUDIODELAY", "0", 1);
+    }
+}
+
+//
+// Find the device that SDL_mixer has opened. It does not tell.
+//
+static SDL_AudioDeviceID FindAudioDevice(void)
+{
+    SDL_AudioDeviceID id;
+
+    for (id = 1; id < 32; id++)
+    {
+        if (SDL_GetAudioDeviceStatus(id) != SDL_AUDIO_STOPPED)
+        {
+            return id;
+        }
+    }
+
+    return 0;
+}
+
+void I_InitCapture(void)
+{
+    const char *filename;
+    int p;
+
+    //!
+    // @arg <file>
+    // @category video
+    //
+    // Record the presented frames in real time to file, as Y4M video
+    // if the file name ends in .y4m and as raw RGB24 frames otherwise.
+    // If the name starts with "|", the frames are piped into that
+    // command as Y4M video instead. Together with -headless, the game
+    // runs as fast as possible instead of in real time.
+    //
+
+    p = M_CheckParmWithArgs("-capture", 1);
+
+    if (p == 0)
+    {
+        return;
+    }
+
+    filename = myargv[p + 1];
+
+    if (filename[0] == '|')
+    {
+        videofile = popen(filename + 1, PIPE_MODE);
+        videopipe = true;
+        y4m = true;
+    }
+    else
+    {
+        videofile = fopen(filename, "wb");
+        y4m = M_StringEndsWith(filename, ".y4m");
+    }
+
+    if (videofile == NULL)
+    {
+        I_Error("I_InitCapture: Could not open %s", filename);
+    }
+
+    freeframes = SDL_CreateSemaphore(NUMCAPTUREBUFFERS);
+    fullframes = SDL_CreateSemaphore(0);
+
+    if (freeframes == NULL || fullframes == NULL)
+    {
+        I_Error("I_InitCapture: %s", SDL_GetError());
+    }
+
+    capturestart = I_GetClockUS();
+
+    //!
+    // @arg <file>
+    // @category sound
+    //
+    // Record the mixed sound output to a WAV file alongside the
+    // -capture video, so that the two can be muxed together later.
+    //
+
+    p = M_CheckParmWithArgs("-captureaudio", 1);
+
+    if (p > 0)
+    {
+        if (!Mix_QuerySpec(&audiofreq, &audioformat, &audiochannels))
+        {
+            fprintf(stderr, "I_InitCapture: Sound is not running, "
+                            "no sound will be recorded.\n");
+        }
+        else
+        {
+            audiofile = fopen(myargv[p + 1], "wb");
+
+            if (audiofile == NULL)
+            {
+                I_Error("I_InitCapture: Could not open %s", myargv[p + 1]);
+            }
+
+            WriteWAVHeader(0);
+
+            audioring = I_Realloc(NULL, AUDIORINGSIZE);
+            SDL_AtomicSet(&audiohead, 0);
+            SDL_AtomicSet(&audiotail, 0);
+
+            if (batch)
+            {
+                audiodevice = FindAudioDevice();
+                audioready = SDL_CreateSemaphore(0);
+
+                if (audiodevice == 0 || audioready == NULL)
+                {
+                    I_Error("I_InitCapture: Could not find the audio device");
+                }
+
+                SDL_LockAudioDevice(audiodevice);
+            }
+
+            Mix_SetPostMix(AudioTap, NULL);
+        }
+    }
+
+    writerthread = SDL_CreateThread(WriterThread, "capture", NULL);
+
+    if (writerthread == NULL)
+    {
+        I_Error("I_InitCapture: %s", SDL_GetError());
+    }
+
+    capturing = true;
+    I_AtExit(I_StopCapture, true);
+}
+
+void I_CaptureFrame(const byte *pixels, int width, int height, int pitch,
+                    uint32_t format, const byte *palette, const byte *tint)
+{
+    captureframe_t *frame;
+    uint64_t now, slots;
+    int y;
+
+    if (!capturing)
+    {
+        return;
+    }
+
+    // The buffers get allocated with the first frame.
+    if (capturewidth == 0)
+    {
+        capturewidth = width;
+        captureheight = height;
+        captureformat = format;
+        bytesperpixel = palette ? 1 : SDL_BYTESPERPIXEL(format);
+
+        for (y = 0; y < NUMCAPTUREBUFFERS; y++)
+        {
+            frames[y].pixels = I_Realloc(NULL, width * height * bytesperpixel);
+        }
+
+        rgbbuffer = I_Realloc(NULL, width * height * 3);
+        yuvbuffer = I_Realloc(NULL, width * height * 3);
+
+        printf("I_CaptureFrame: Recording %dx%d at %d fps.\n",
+               width, height, capturefps);
+    }
+    else if (width != capturewidth || height != captureheight)
+    {
+        fprintf(stderr, "I_CaptureFrame: The resolution changed, "
+                        "the capture is stopped.\n");
+        I_StopCapture();
+        return;
+    }
+
+    // Fill all output frames up to the current time with this frame,
+    // none if the current output frame already has one.
+    now = I_GetClockUS() - capturestart;
+    slots = now * capturefps / 1000000 + 1;
+
+    if (slots <= outputframes)
+    {
+        return;
+    }
+
+    SDL_SemWait(freeframes);
+
+    frame = &frames[nextframe];
+    frame->repeat = (int) (slots - outputframes);
+    outputframes = slots;
+
+    for (y = 0; y < height; y++)
+    {
+        memcpy(frame->pixels + y * width * bytesperpixel,
+               pixels + y * pitch, width * bytesperpixel);
+    }
+
+    if (palette)
+    {
+        memcpy(frame->palette, palette, sizeof(frame->palette));
+    }
+
+    frame->tinted = tint != NULL;
+
+    if (tint)
+    {
+        memcpy(frame->tint, tint, sizeof(frame->tint));
+    }
+
+    nextframe = (nextframe + 1) % NUMCAPTUREBUFFERS;
+    SDL_SemPost(fullframes);
+
+    // Let the sound be mixed up to the current game time.
+    if (audiodevice)
+    {
+        const uint64_t target = now * audiofreq / 1000000
+                              * audiochannels * SDL_AUDIO_BITSIZE(audioformat) / 8;
+
+        while (audiomixed < target)
+        {
+            SDL_UnlockAudioDevice(audiodevice);
+            SDL_SemWait(audioready);
+            SDL_LockAudioDevice(audiodevice);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      [crispy] Real-time video and audio capture
+//
+
+
+#ifndef __I_CAPTURE__
+#define __I_CAPTURE__
+
+#include "doomtype.h"
+
+// true while frames are being captured
+extern boolean capturing;
+
+// Check the command line for batch rendering, which has to be set up
+// before the timer and the sound.
+void I_CaptureCheckCommandLine(void);
+
+// Check the command line and start capturing, if requested.
+// Has to be called after the sound and the graphics are set up.
+void I_InitCapture(void);
+
+// Capture a presented frame, either paletted with palette pointing to
+// 256 r, g, b, a entries, or in the given SDL pixel format. tint is an
+// r, g, b, a color to blend over the frame, or NULL.
+void I_CaptureFrame(const byte *pixels, int width, int height, int pitch,
+                    uint32_t format, const byte *palette, const byte *tint);
+
+#endif
+
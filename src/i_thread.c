@@ -0,0 +1,197 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Worker thread pool.
+//
+
+#include "SDL.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+#include "doomtype.h"
+
+struct i_mutex_s
+{
+    SDL_mutex *mutex;
+};
+
+static SDL_Thread *threads[MAXTHREADS];
+static int numthreads = 1;
+
+static SDL_sem *startsem;
+static SDL_sem *donesem;
+static boolean shutting_down;
+
+// The current batch of jobs. Workers pick the next free index off
+// nextjob, so that threads finishing early take over the remaining work.
+
+static i_threadjob_t curjob;
+static void *curdata;
+static int curcount;
+static SDL_atomic_t nextjob;
+
+static void RunJobs(void)
+{
+    int index;
+
+    while ((index = SDL_AtomicAdd(&nextjob, 1)) < curcount)
+    {
+        curjob(index, curdata);
+    }
+}
+
+static int WorkerThread(void *unused)
+{
+    for (;;)
+    {
+        SDL_SemWait(startsem);
+
+        if (shutting_down)
+        {
+            break;
+        }
+
+        RunJobs();
+        SDL_SemPost(donesem);
+    }
+
+    return 0;
+}
+
+static void I_ShutdownThreads(void)
+{
+    int i;
+
+    shutting_down = true;
+
+    for (i = 1; i < numthreads; ++i)
+    {
+        SDL_SemPost(startsem);
+    }
+
+    for (i = 1; i < numthreads; ++i)
+    {
+        // A worker that ends up here through I_Error() can't wait
+        // for itself.
+        if (SDL_GetThreadID(threads[i]) == SDL_ThreadID())
+        {
+            SDL_DetachThread(threads[i]);
+            continue;
+        }
+
+        SDL_WaitThread(threads[i], NULL);
+    }
+
+    numthreads = 1;
+}
+
+void I_InitThreads(int count)
+{
+    int i;
+
+    if (numthreads > 1 || count <= 1)
+    {
+        return;
+    }
+
+    if (count > MAXTHREADS)
+    {
+        count = MAXTHREADS;
+    }
+
+    startsem = SDL_CreateSemaphore(0);
+    donesem = SDL_CreateSemaphore(0);
+
+    if (startsem == NULL || donesem == NULL)
+    {
+        I_Error("I_InitThreads: %s", SDL_GetError());
+    }
+
+    for (i = 1; i < count; ++i)
+    {
+        threads[i] = SDL_CreateThread(WorkerThread, "worker", NULL);
+
+        if (threads[i] == NULL)
+        {
+            break;
+        }
+
+        numthreads = i + 1;
+    }
+
+    I_AtExit(I_ShutdownThreads, true);
+}
+
+int I_NumThreads(void)
+{
+    return numthreads;
+}
+
+void I_RunThreadJobs(int count, int maxthreads, i_threadjob_t job, void *data)
+{
+    int i, workers;
+
+    curjob = job;
+    curdata = data;
+    curcount = count;
+    SDL_AtomicSet(&nextjob, 0);
+
+    // The pool is sized for the busiest user, so only wake up as many
+    // workers as this one asked for, and no more than there are jobs.
+    workers = (maxthreads < numthreads ? maxthreads : numthreads);
+    workers = (count < workers ? count : workers) - 1;
+
+    for (i = 0; i < workers; ++i)
+    {
+        SDL_SemPost(startsem);
+    }
+
+    RunJobs();
+
+    for (i = 0; i < workers; ++i)
+    {
+        SDL_SemWait(donesem);
+    }
+}
+
+i_mutex_t *I_CreateMutex(void)
+{
+    i_mutex_t *result;
+
+    result = I_Realloc(NULL, sizeof(*result));
+    result->mutex = SDL_CreateMutex();
+
+    if (result->mutex == NULL)
+    {
+        I_Error("I_CreateMutex: %s", SDL_GetError());
+    }
+
+    return result;
+}
+
+void I_LockMutex(i_mutex_t *mutex)
+{
+    SDL_LockMutex(mutex->mutex);
+}
+
+void I_UnlockMutex(i_mutex_t *mutex)
+{
+    SDL_UnlockMutex(mutex->mutex);
+}
+
+void I_MemoryBarrier(void)
+{
+    SDL_MemoryBarrierRelease();
+}
+
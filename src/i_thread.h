@@ -0,0 +1,49 @@
+//
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      System-specific worker thread interface
+//
+
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+// Maximum number of threads (including the main thread) in the pool.
+#define MAXTHREADS 32
+
+// A job function; index counts from 0 to the number of jobs - 1.
+typedef void (*i_threadjob_t)(int index, void *data);
+
+typedef struct i_mutex_s i_mutex_t;
+
+// Start the worker pool with the given total number of threads.
+void I_InitThreads(int numthreads);
+
+// Returns the total number of threads, including the main thread.
+int I_NumThreads(void);
+
+// Run count jobs on at most maxthreads threads of the pool and wait until
+// all of them have finished. The calling thread takes part in running them.
+void I_RunThreadJobs(int count, int maxthreads, i_threadjob_t job, void *data);
+
+i_mutex_t *I_CreateMutex(void);
+void I_LockMutex(i_mutex_t *mutex);
+void I_UnlockMutex(i_mutex_t *mutex);
+
+// Make all preceding writes visible to other threads before any
+// subsequent ones.
+void I_MemoryBarrier(void);
+
+#endif
+
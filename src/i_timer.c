@@ -18,6 +18,12 @@
 
 #include "SDL.h"
 
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__)
+#include <errno.h>
+#include <time.h>
+#define HAVE_CLOCK_NANOSLEEP
+#endif
+
 #include "i_timer.h"
 #include "doomtype.h"
 
@@ -28,10 +34,19 @@
 
 static Uint32 basetime = 0;
 
+// [crispy] virtual clock, see I_SetVirtualClock()
+static int virtualfps = 0;
+static uint64_t virtualframes, virtualsleep;
+
 int  I_GetTime (void)
 {
     Uint32 ticks;
 
+    if (virtualfps)
+    {
+        return (int) (I_GetClockUS() * TICRATE / 1000000);
+    }
+
     ticks = SDL_GetTicks();
 
     if (basetime == 0)
@@ -50,6 +65,11 @@ int I_GetTimeMS(void)
 {
     Uint32 ticks;
 
+    if (virtualfps)
+    {
+        return (int) (I_GetClockUS() / 1000);
+    }
+
     ticks = SDL_GetTicks();
 
     if (basetime == 0)
@@ -58,10 +78,40 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+//
+// [crispy] Same as I_GetTimeMS, but returns time in microseconds,
+// measured with the high-resolution performance counter
+//
+
+uint64_t I_GetTimeUS(void)
+{
+    static Uint64 basecounter = 0, frequency = 0;
+    Uint64 counter;
+
+    counter = SDL_GetPerformanceCounter();
+
+    if (frequency == 0)
+    {
+        frequency = SDL_GetPerformanceFrequency();
+        basecounter = counter;
+    }
+
+    counter -= basecounter;
+
+    return (counter / frequency) * 1000000 +
+           (counter % frequency) * 1000000 / frequency;
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
 {
+    if (virtualfps)
+    {
+        virtualsleep += ms * 1000;
+        return;
+    }
+
     SDL_Delay(ms);
 }
 
@@ -70,6 +120,181 @@ void I_WaitVBL(int count)
     I_Sleep((count * 1000) / 70);
 }
 
+//
+// [crispy] Precise sleeping: the OS may wake us up late, so sleep until
+// this much before the deadline and busy-wait for the rest. It adapts
+// to the oversleeping that is actually observed.
+//
+
+#ifdef HAVE_CLOCK_NANOSLEEP
+static int sleepslack = 500;
+#else
+static int sleepslack = 2000;
+#endif
+
+#define MINSLEEPSLACK 100
+#define MAXSLEEPSLACK 4000
+
+static void SleepUS(int us)
+{
+#ifdef HAVE_CLOCK_NANOSLEEP
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR);
+#else
+    SDL_Delay(us / 1000);
+#endif
+}
+
+void I_SleepUntilUS(uint64_t deadline)
+{
+    uint64_t now = I_GetTimeUS();
+
+    while (now + sleepslack < deadline)
+    {
+        const int us = (int) (deadline - now) - sleepslack;
+        uint64_t woken;
+        int late;
+
+        SleepUS(us);
+
+        woken = I_GetTimeUS();
+        late = (int) (woken - now) - us;
+
+        // react to late wakeups at once, relax slowly
+        if (late > sleepslack)
+        {
+            sleepslack = late < MAXSLEEPSLACK ? late : MAXSLEEPSLACK;
+        }
+        else
+        {
+            sleepslack -= (sleepslack - (late > 0 ? late : 0)) / 16;
+
+            if (sleepslack < MINSLEEPSLACK)
+            {
+                sleepslack = MINSLEEPSLACK;
+            }
+        }
+
+        now = woken;
+    }
+
+    while (now < deadline)
+    {
+        now = I_GetTimeUS();
+    }
+}
+
+//
+// [crispy] Frame pacing
+//
+
+static uint64_t nextframe, lastframe;
+
+static uint64_t pacingsum, pacingsqsum;
+static int pacingframes;
+static int pacingaverage, pacingdeviation;
+
+// i_timer.c is also linked without libm, so no sqrt()
+static uint64_t SquareRoot(uint64_t x)
+{
+    uint64_t r = x, y = (x + 1) / 2;
+
+    while (y < r)
+    {
+        r = y;
+        y = (r + x / r) / 2;
+    }
+
+    return r;
+}
+
+void I_PaceFrame(int fps)
+{
+    uint64_t now = I_GetTimeUS();
+    uint64_t interval;
+
+    if (virtualfps)
+    {
+        virtualframes++;
+        return;
+    }
+
+    if (fps > 0)
+    {
+        const uint64_t period = 1000000 / fps;
+
+        // start over if a frame took too long or the limit was lowered,
+        // rather than trying to catch up
+        if (nextframe + period < now || nextframe > now + period)
+        {
+            nextframe = now;
+        }
+        else
+        {
+            I_SleepUntilUS(nextframe);
+            now = I_GetTimeUS();
+        }
+
+        nextframe += period;
+    }
+
+    interval = now - lastframe;
+    lastframe = now;
+
+    if (interval == now)
+    {
+        return;
+    }
+
+    pacingsum += interval;
+    pacingsqsum += interval * interval;
+    pacingframes++;
+
+    if (pacingsum >= 1000000)
+    {
+        const uint64_t avg = pacingsum / pacingframes;
+        const uint64_t sqavg = pacingsqsum / pacingframes;
+
+        pacingaverage = (int) avg;
+        pacingdeviation = sqavg > avg * avg ? (int) SquareRoot(sqavg - avg * avg) : 0;
+
+        pacingsum = pacingsqsum = 0;
+        pacingframes = 0;
+    }
+}
+
+void I_FramePacing(int *average, int *deviation)
+{
+    *average = pacingaverage;
+    *deviation = pacingdeviation;
+}
+
+void I_SetVirtualClock(int fps)
+{
+    virtualfps = fps;
+    virtualframes = 0;
+    virtualsleep = 0;
+}
+
+uint64_t I_GetClockUS(void)
+{
+    if (virtualfps)
+    {
+        return virtualframes * 1000000 / virtualfps + virtualsleep;
+    }
+
+    return I_GetTimeUS();
+}
+
+boolean I_VirtualClock(void)
+{
+    return virtualfps != 0;
+}
+
 
 void I_InitTimer(void)
 {
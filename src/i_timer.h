@@ -20,6 +20,8 @@
 #ifndef __I_TIMER__
 #define __I_TIMER__
 
+#include "doomtype.h"
+
 #define TICRATE 35
 
 // Called by D_DoomLoop,
@@ -29,9 +31,32 @@ int I_GetTime (void);
 // returns current time in ms
 int I_GetTimeMS (void);
 
+// [crispy] returns current time in us, with sub-ms resolution
+uint64_t I_GetTimeUS (void);
+
 // Pause for a specified number of ms
 void I_Sleep(int ms);
 
+// [crispy] wait until the given I_GetTimeUS() time, with sub-ms accuracy
+void I_SleepUntilUS(uint64_t deadline);
+
+// [crispy] called once per frame, waits for the next frame if fps > 0
+void I_PaceFrame(int fps);
+
+// [crispy] average and standard deviation of the time between two
+// frames in us, measured over the last second
+void I_FramePacing(int *average, int *deviation);
+
+// [crispy] batch rendering: the game time stands still, except that
+// I_Sleep() advances it and each I_PaceFrame() takes 1/fps seconds
+void I_SetVirtualClock(int fps);
+
+// [crispy] game time in us, either I_GetTimeUS() or the virtual time
+uint64_t I_GetClockUS(void);
+
+// [crispy] true while the virtual clock is in use
+boolean I_VirtualClock(void);
+
 // Initialize timer
 void I_InitTimer(void);
 
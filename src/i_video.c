@@ -37,6 +37,7 @@
 #include "d_loop.h"
 #include "deh_str.h"
 #include "doomtype.h"
+#include "i_capture.h"
 #include "i_input.h"
 #include "i_joystick.h"
 #include "i_system.h"
@@ -98,6 +99,12 @@ static SDL_Texture *redpane = NULL;
 static SDL_Texture *yelpane = NULL;
 static SDL_Texture *grnpane = NULL;
 static int pane_alpha;
+// [crispy] color of the current pane, kept even when there are no pane
+// textures, e.g. for -headless captures
+static const byte redtint[3] = {0xff, 0x00, 0x00};
+static const byte yeltint[3] = {0xd7, 0xba, 0x45};
+static const byte grntint[3] = {0x00, 0xff, 0x00};
+static const byte *curtint = NULL;
 static unsigned int rmask, gmask, bmask, amask; // [crispy] moved up here
 static const uint8_t blend_alpha = 0xa8;
 extern pixel_t* colormaps; // [crispy] evil hack to get FPS dots working as in Vanilla
@@ -106,10 +113,64 @@ static SDL_Color palette[256];
 #endif
 static boolean palette_to_set;
 
+// [crispy] the whole intermediate texture needs to be uploaded again
+
+static boolean texture_stale = true;
+
+#ifndef CRISPY_TRUECOLOR
+// [crispy] the paletted frame that was last uploaded, compared row by row
+// against the current one so that only the changed rows get converted
+// and uploaded
+
+static byte *lastframe = NULL;
+static int lastframe_size;
+
+// [crispy] palette mapped to the pixel format of argbbuffer
+
+static uint32_t palette32[256];
+
+static void ExpandRow (uint32_t *dest, const byte *src, int count);
+static void (*expand_row) (uint32_t *dest, const byte *src, int count) = ExpandRow;
+#endif
+
+// [crispy] the frame to present, with the palette or the palette pane
+// that it was finished with
+
+static struct
+{
+    SDL_Surface *frame;
+#ifndef CRISPY_TRUECOLOR
+    SDL_Color palette[256];
+    boolean palette_set;
+#else
+    SDL_Texture *pane;
+    int pane_alpha;
+#endif
+} present;
+
+// [crispy] pipelined presentation: the video thread presents a copy of
+// the last frame while the main thread goes on with the next one, until
+// that needs input for a new tic. Only one of the two threads uses the
+// renderer at any time.
+
+static SDL_Thread *videothread = NULL;
+static SDL_sem *videothread_start;
+static SDL_sem *videothread_done;
+static boolean videothread_busy;
+static boolean videothread_quit;
+static boolean videothread_gl;
+static SDL_Surface *presentbuffer = NULL;
+
+static void StopVideoThread (void);
+
 // display has been set up?
 
 static boolean initialized = false;
 
+// [crispy] render into I_VideoBuffer without any SDL video output?
+
+static boolean headless = false;
+
 // disable mouse?
 
 static boolean nomouse = false;
@@ -290,9 +351,14 @@ void I_ShutdownGraphics(void)
 {
     if (initialized)
     {
-        SetShowCursor(true);
+        if (!headless)
+        {
+            StopVideoThread();
 
-        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+            SetShowCursor(true);
+
+            SDL_QuitSubSystem(SDL_INIT_VIDEO);
+        }
 
         initialized = false;
     }
@@ -433,6 +499,8 @@ static void I_ToggleFullScreen(void)
         return;
     }
 
+    I_WaitVideoThread();
+
     fullscreen = !fullscreen;
 
     if (fullscreen)
@@ -502,6 +570,11 @@ void I_GetEvent(void)
                 }
                 break;
 
+            // [crispy] texture contents may have been lost
+            case SDL_RENDER_DEVICE_RESET:
+                palette_to_set = true;
+                break;
+
             default:
                 break;
         }
@@ -513,11 +586,15 @@ void I_GetEvent(void)
 //
 void I_StartTic (void)
 {
-    if (!initialized)
+    if (!initialized || headless)
     {
         return;
     }
 
+    // [crispy] the last frame must be on screen before input for the next
+    // tic is read, or presenting on the video thread would add latency
+    I_WaitVideoThread();
+
     I_GetEvent();
 
     if (usemouse && !nomouse && window_focused)
@@ -729,6 +806,347 @@ static void CreateUpscaledTexture(boolean force)
     }
 }
 
+#ifndef CRISPY_TRUECOLOR
+//
+// [crispy] Convert a row of paletted pixels to argbbuffer's format.
+//
+static void ExpandRow (uint32_t *dest, const byte *src, int count)
+{
+    while (count >= 4)
+    {
+        dest[0] = palette32[src[0]];
+        dest[1] = palette32[src[1]];
+        dest[2] = palette32[src[2]];
+        dest[3] = palette32[src[3]];
+        dest += 4;
+        src += 4;
+        count -= 4;
+    }
+
+    while (count-- > 0)
+    {
+        *dest++ = palette32[*src++];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HAVE_EXPAND_AVX2
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+static void ExpandRowAVX2 (uint32_t *dest, const byte *src, int count)
+{
+    while (count >= 8)
+    {
+        const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) src));
+
+        _mm256_storeu_si256((__m256i *) dest,
+                            _mm256_i32gather_epi32((const int *) palette32, index, 4));
+        dest += 8;
+        src += 8;
+        count -= 8;
+    }
+
+    ExpandRow(dest, src, count);
+}
+#endif
+
+//
+// [crispy] Convert the rows of the frame that changed since the last
+// frame to argbbuffer and upload them to the texture. Nothing is done if
+// the frame is unchanged, e.g. on menus and static screens.
+//
+static void UpdateTextureRows (SDL_Surface *frame)
+{
+    const int width = frame->w, height = frame->h;
+    const int size = width * height;
+    const byte *src = frame->pixels;
+    byte *last;
+    int y, top = height, bottom = -1;
+    SDL_Rect rect;
+
+    if (argbbuffer->format->BytesPerPixel != 4)
+    {
+        SDL_LowerBlit(frame, &blit_rect, argbbuffer, &blit_rect);
+        SDL_UpdateTexture(texture, NULL, argbbuffer->pixels, argbbuffer->pitch);
+        return;
+    }
+
+    if (lastframe_size != size)
+    {
+        lastframe = I_Realloc(lastframe, size);
+        lastframe_size = size;
+        texture_stale = true;
+    }
+
+    if (texture_stale)
+    {
+        int i;
+
+        for (i = 0; i < 256; i++)
+        {
+            palette32[i] = SDL_MapRGB(argbbuffer->format, present.palette[i].r,
+                                      present.palette[i].g, present.palette[i].b);
+        }
+    }
+
+    last = lastframe;
+
+    for (y = 0; y < height; y++)
+    {
+        if (texture_stale || memcmp(last, src, width))
+        {
+            expand_row((uint32_t *) ((byte *) argbbuffer->pixels + y * argbbuffer->pitch),
+                       src, width);
+            memcpy(last, src, width);
+
+            if (top > y)
+            {
+                top = y;
+            }
+            bottom = y;
+        }
+
+        src += frame->pitch;
+        last += width;
+    }
+
+    texture_stale = false;
+
+    if (bottom < top)
+    {
+        return;
+    }
+
+    rect.x = 0;
+    rect.y = top;
+    rect.w = width;
+    rect.h = bottom - top + 1;
+
+    SDL_UpdateTexture(texture, &rect,
+                      (byte *) argbbuffer->pixels + top * argbbuffer->pitch,
+                      argbbuffer->pitch);
+}
+#endif
+
+//
+// [crispy] Upload present.frame to the texture and render it to screen.
+//
+static void PresentFrame (void)
+{
+#ifndef CRISPY_TRUECOLOR
+    if (present.palette_set)
+    {
+        if (present.frame != screenbuffer)
+        {
+            SDL_SetPaletteColors(present.frame->format->palette,
+                                 present.palette, 0, 256);
+        }
+        present.palette_set = false;
+        texture_stale = true;
+
+        if (vga_porch_flash)
+        {
+            // "flash" the pillars/letterboxes with palette changes, emulating
+            // VGA "porch" behaviour (GitHub issue #832)
+            SDL_SetRenderDrawColor(renderer, present.palette[0].r,
+                present.palette[0].g, present.palette[0].b, SDL_ALPHA_OPAQUE);
+        }
+    }
+
+    // Convert the paletted 8-bit screen buffer to the intermediate
+    // 32-bit RGBA buffer and update the intermediate texture with it.
+    // [crispy] only the rows that changed since the last frame
+
+    UpdateTextureRows(present.frame);
+#else
+    // Update the intermediate texture with the contents of the RGBA buffer.
+
+    SDL_UpdateTexture(texture, NULL, present.frame->pixels, present.frame->pitch);
+#endif
+
+    // Make sure the pillarboxes are kept clear each frame.
+
+    SDL_RenderClear(renderer);
+
+    if (crispy->smoothscaling)
+    {
+    // Render this intermediate texture into the upscaled texture
+    // using "nearest" integer scaling.
+
+    SDL_SetRenderTarget(renderer, texture_upscaled);
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+
+    // Finally, render this upscaled texture to screen using linear scaling.
+
+    SDL_SetRenderTarget(renderer, NULL);
+    SDL_RenderCopy(renderer, texture_upscaled, NULL, NULL);
+    }
+    else
+    {
+	SDL_SetRenderTarget(renderer, NULL);
+	SDL_RenderCopy(renderer, texture, NULL, NULL);
+    }
+
+#ifdef CRISPY_TRUECOLOR
+    if (present.pane)
+    {
+	SDL_SetTextureAlphaMod(present.pane, present.pane_alpha);
+	SDL_RenderCopy(renderer, present.pane, NULL, NULL);
+    }
+#endif
+
+    // Draw!
+
+    SDL_RenderPresent(renderer);
+}
+
+//
+// [crispy] With an OpenGL renderer, its context has to be released
+// by one thread before the other one can make it current.
+//
+static void ReleaseRenderContext (void)
+{
+    if (videothread_gl)
+    {
+        SDL_GL_MakeCurrent(screen, NULL);
+    }
+}
+
+static int VideoThread (void *unused)
+{
+    for (;;)
+    {
+        SDL_SemWait(videothread_start);
+
+        if (videothread_quit)
+        {
+            break;
+        }
+
+        PresentFrame();
+        ReleaseRenderContext();
+
+        SDL_SemPost(videothread_done);
+    }
+
+    return 0;
+}
+
+//
+// [crispy] Wait until the video thread has presented its frame and the
+// renderer may be used by the calling thread again.
+//
+void I_WaitVideoThread (void)
+{
+    if (videothread_busy)
+    {
+        SDL_SemWait(videothread_done);
+        videothread_busy = false;
+    }
+}
+
+//
+// [crispy] Copy the frame, so that the next one can be drawn into the
+// framebuffer right away, and have the video thread present it.
+//
+static void PresentOnVideoThread (SDL_Surface *frame)
+{
+    if (presentbuffer == NULL ||
+        presentbuffer->w != frame->w || presentbuffer->h != frame->h ||
+        presentbuffer->format->format != frame->format->format)
+    {
+        SDL_FreeSurface(presentbuffer);
+        presentbuffer = SDL_ConvertSurface(frame, frame->format, 0);
+
+        if (presentbuffer == NULL)
+        {
+            I_Error("PresentOnVideoThread: %s", SDL_GetError());
+        }
+#ifndef CRISPY_TRUECOLOR
+        // [crispy] the new surface starts out with the current palette
+        memcpy(present.palette, palette, sizeof(palette));
+        present.palette_set = true;
+#endif
+    }
+    else
+    {
+        memcpy(presentbuffer->pixels, frame->pixels, frame->h * frame->pitch);
+    }
+
+    present.frame = presentbuffer;
+
+    ReleaseRenderContext();
+    videothread_busy = true;
+    SDL_SemPost(videothread_start);
+}
+
+static void StartVideoThread (void)
+{
+#if defined(__APPLE__)
+    // [crispy] rendering has to happen on the main thread here
+    fprintf(stderr, "StartVideoThread: Not supported on this platform.\n");
+#else
+    SDL_RendererInfo info;
+
+    videothread_start = SDL_CreateSemaphore(0);
+    videothread_done = SDL_CreateSemaphore(0);
+
+    if (videothread_start == NULL || videothread_done == NULL)
+    {
+        I_Error("StartVideoThread: %s", SDL_GetError());
+    }
+
+    if (SDL_GetRendererInfo(renderer, &info) == 0)
+    {
+        videothread_gl = !strncmp(info.name, "opengl", 6);
+    }
+
+    videothread = SDL_CreateThread(VideoThread, "video", NULL);
+
+    if (videothread == NULL)
+    {
+        fprintf(stderr, "StartVideoThread: %s\n", SDL_GetError());
+    }
+#endif
+}
+
+static void StopVideoThread (void)
+{
+    if (videothread)
+    {
+        I_WaitVideoThread();
+
+        videothread_quit = true;
+        SDL_SemPost(videothread_start);
+        SDL_WaitThread(videothread, NULL);
+        videothread = NULL;
+    }
+}
+
+#ifdef CRISPY_TRUECOLOR
+//
+// [crispy] The color and alpha of the current palette pane, which
+// is only blended over the frame by the renderer.
+//
+static const byte *PaneTint (void)
+{
+    static byte tint[4];
+
+    if (curtint == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(tint, curtint, 3);
+    tint[3] = pane_alpha;
+
+    return tint;
+}
+#endif
+
 // [AM] Fractional part of the current tic, in the half-open
 //      range of [0.0, 1.0).  Used for interpolation.
 fixed_t fractionaltic;
@@ -748,6 +1166,10 @@ void I_FinishUpdate (void)
     if (noblit)
         return;
 
+    // [crispy] the previous frame must be on screen before this one
+    // gets handed over and before the renderer is used here
+    I_WaitVideoThread();
+
     if (need_resize)
     {
         if (SDL_GetTicks() > last_resize_time + RESIZE_DELAY)
@@ -775,7 +1197,10 @@ void I_FinishUpdate (void)
         }
     }
 
-    UpdateGrab();
+    if (!headless)
+    {
+        UpdateGrab();
+    }
 
 #if 0 // SDL2-TODO
     // Don't update the screen if the window isn't visible.
@@ -829,68 +1254,67 @@ void I_FinishUpdate (void)
 		}
 	}
 
+    // [crispy] record the frame, without the disk icon
+    if (capturing)
+    {
+#ifndef CRISPY_TRUECOLOR
+        I_CaptureFrame(screenbuffer->pixels, screenbuffer->w, screenbuffer->h,
+                       screenbuffer->pitch, 0, (const byte *) palette, NULL);
+#else
+        I_CaptureFrame(argbbuffer->pixels, argbbuffer->w, argbbuffer->h,
+                       argbbuffer->pitch, argbbuffer->format->format, NULL,
+                       PaneTint());
+#endif
+    }
+
     // Draw disk icon before blit, if necessary.
     V_DrawDiskIcon();
 
+    // [crispy] the frame is complete in I_VideoBuffer, there is
+    // no window to present it in
+    if (headless)
+    {
+	if (crispy->uncapped)
+	{
+	    fractionaltic = I_GetTimeMS() * TICRATE % 1000 * FRACUNIT / 1000;
+	}
+
+	V_RestoreDiskBackground();
+	return;
+    }
+
+    // [crispy] take over the palette or the palette pane that the
+    // frame has been finished with
 #ifndef CRISPY_TRUECOLOR
     if (palette_to_set)
     {
         SDL_SetPaletteColors(screenbuffer->format->palette, palette, 0, 256);
+        memcpy(present.palette, palette, sizeof(palette));
+        present.palette_set = true;
         palette_to_set = false;
-
-        if (vga_porch_flash)
-        {
-            // "flash" the pillars/letterboxes with palette changes, emulating
-            // VGA "porch" behaviour (GitHub issue #832)
-            SDL_SetRenderDrawColor(renderer, palette[0].r, palette[0].g,
-                palette[0].b, SDL_ALPHA_OPAQUE);
-        }
     }
-
-    // Blit from the paletted 8-bit screen buffer to the intermediate
-    // 32-bit RGBA buffer that we can load into the texture.
-
-    SDL_LowerBlit(screenbuffer, &blit_rect, argbbuffer, &blit_rect);
+#else
+    present.pane = curpane;
+    present.pane_alpha = pane_alpha;
 #endif
 
-    // Update the intermediate texture with the contents of the RGBA buffer.
-
-    SDL_UpdateTexture(texture, NULL, argbbuffer->pixels, argbbuffer->pitch);
-
-    // Make sure the pillarboxes are kept clear each frame.
-
-    SDL_RenderClear(renderer);
-
-    if (crispy->smoothscaling)
+    if (videothread)
     {
-    // Render this intermediate texture into the upscaled texture
-    // using "nearest" integer scaling.
-
-    SDL_SetRenderTarget(renderer, texture_upscaled);
-    SDL_RenderCopy(renderer, texture, NULL, NULL);
-
-    // Finally, render this upscaled texture to screen using linear scaling.
-
-    SDL_SetRenderTarget(renderer, NULL);
-    SDL_RenderCopy(renderer, texture_upscaled, NULL, NULL);
+#ifndef CRISPY_TRUECOLOR
+        PresentOnVideoThread(screenbuffer);
+#else
+        PresentOnVideoThread(argbbuffer);
+#endif
     }
     else
     {
-	SDL_SetRenderTarget(renderer, NULL);
-	SDL_RenderCopy(renderer, texture, NULL, NULL);
-    }
-
-#ifdef CRISPY_TRUECOLOR
-    if (curpane)
-    {
-	SDL_SetTextureAlphaMod(curpane, pane_alpha);
-	SDL_RenderCopy(renderer, curpane, NULL, NULL);
-    }
+#ifndef CRISPY_TRUECOLOR
+        present.frame = screenbuffer;
+#else
+        present.frame = argbbuffer;
 #endif
-
-    // Draw!
-
-    SDL_RenderPresent(renderer);
+        PresentFrame();
+    }
 
     // [AM] Figure out how far into the current tic we're in as a fixed_t.
     if (crispy->uncapped)
@@ -1004,6 +1428,7 @@ void I_SetPalette (int palette)
     {
 	case 0:
 	    curpane = NULL;
+	    curtint = NULL;
 	    break;
 	case 1:
 	case 2:
@@ -1014,6 +1439,7 @@ void I_SetPalette (int palette)
 	case 7:
 	case 8:
 	    curpane = redpane;
+	    curtint = redtint;
 	    pane_alpha = 0xff * palette / 9;
 	    break;
 	case 9:
@@ -1021,10 +1447,12 @@ void I_SetPalette (int palette)
 	case 11:
 	case 12:
 	    curpane = yelpane;
+	    curtint = yeltint;
 	    pane_alpha = 0xff * (palette - 8) / 8;
 	    break;
 	case 13:
 	    curpane = grnpane;
+	    curtint = grntint;
 	    pane_alpha = 0xff * 125 / 1000;
 	    break;
 	default:
@@ -1052,6 +1480,11 @@ void I_InitWindowTitle(void)
 {
     char *buf;
 
+    if (headless)
+    {
+        return;
+    }
+
     buf = M_StringJoin(window_title, " - ", PACKAGE_STRING, NULL);
     SDL_SetWindowTitle(screen, buf);
     free(buf);
@@ -1221,6 +1654,61 @@ void I_GraphicsCheckCommandLine(void)
     {
         SetScaleFactor(3);
     }
+
+    //!
+    // @category video
+    //
+    // Render every frame into the framebuffer without initializing any
+    // SDL video output. No window is opened and no input is read. This
+    // is intended for measuring renderer throughput on machines without
+    // a display, e.g. together with -timedemo and -nosound.
+    //
+
+    headless = M_ParmExists("-headless");
+
+    //!
+    // @category video
+    //
+    // Render in high resolution (640x400).
+    //
+
+    if (M_ParmExists("-hires"))
+    {
+        crispy->hires = 1;
+    }
+
+    //!
+    // @category video
+    //
+    // Render in low resolution (320x200).
+    //
+
+    if (M_ParmExists("-lores"))
+    {
+        crispy->hires = 0;
+    }
+
+    //!
+    // @category video
+    // @arg <n>
+    //
+    // Set the widescreen rendering aspect ratio: 0 (off), 1 (match
+    // screen), 2 (16:10), 3 (16:9) or 4 (21:9).
+    //
+
+    i = M_CheckParmWithArgs("-widescreen", 1);
+
+    if (i > 0)
+    {
+        int ratio = atoi(myargv[i + 1]);
+
+        if (ratio < 0 || ratio >= NUM_RATIOS)
+        {
+            I_Error("Invalid widescreen ratio: %s", myargv[i + 1]);
+        }
+
+        crispy->widescreen = ratio;
+    }
 }
 
 // Check if we have been invoked as a screensaver by xscreensaver.
@@ -1314,14 +1802,73 @@ void I_GetWindowPosition(int *x, int *y, int w, int h)
     }
 }
 
-static void SetVideoMode(void)
+// Create the framebuffer surfaces that the game is rendered into.
+
+static void CreateFramebuffers(void)
 {
-    int w, h;
-    int x, y;
 #ifndef CRISPY_TRUECOLOR
     unsigned int rmask, gmask, bmask, amask;
 #endif
     int bpp;
+
+#ifndef CRISPY_TRUECOLOR
+    // Create the 8-bit paletted and the 32-bit RGBA screenbuffer surfaces.
+
+    if (screenbuffer != NULL)
+    {
+        SDL_FreeSurface(screenbuffer);
+        screenbuffer = NULL;
+    }
+
+    if (screenbuffer == NULL)
+    {
+        screenbuffer = SDL_CreateRGBSurface(0,
+                                            SCREENWIDTH, SCREENHEIGHT, 8,
+                                            0, 0, 0, 0);
+        SDL_FillRect(screenbuffer, NULL, 0);
+    }
+#endif
+
+    // Format of argbbuffer must match the screen pixel format because we
+    // import the surface data into the texture.
+
+    if (argbbuffer != NULL)
+    {
+        SDL_FreeSurface(argbbuffer);
+        argbbuffer = NULL;
+    }
+
+    if (argbbuffer == NULL)
+    {
+        SDL_PixelFormatEnumToMasks(pixel_format, &bpp,
+                                   &rmask, &gmask, &bmask, &amask);
+        argbbuffer = SDL_CreateRGBSurface(0,
+                                          SCREENWIDTH, SCREENHEIGHT, bpp,
+                                          rmask, gmask, bmask, amask);
+#ifdef CRISPY_TRUECOLOR
+        if (!headless)
+        {
+            SDL_FillRect(argbbuffer, NULL, I_MapRGB(0xff, 0x0, 0x0));
+            redpane = SDL_CreateTextureFromSurface(renderer, argbbuffer);
+            SDL_SetTextureBlendMode(redpane, SDL_BLENDMODE_BLEND);
+
+            SDL_FillRect(argbbuffer, NULL, I_MapRGB(0xd7, 0xba, 0x45));
+            yelpane = SDL_CreateTextureFromSurface(renderer, argbbuffer);
+            SDL_SetTextureBlendMode(yelpane, SDL_BLENDMODE_BLEND);
+
+            SDL_FillRect(argbbuffer, NULL, I_MapRGB(0x0, 0xff, 0x0));
+            grnpane = SDL_CreateTextureFromSurface(renderer, argbbuffer);
+            SDL_SetTextureBlendMode(grnpane, SDL_BLENDMODE_BLEND);
+        }
+#endif
+        SDL_FillRect(argbbuffer, NULL, 0);
+    }
+}
+
+static void SetVideoMode(void)
+{
+    int w, h;
+    int x, y;
     int window_flags = 0, renderer_flags = 0;
     SDL_DisplayMode mode;
 
@@ -1468,55 +2015,7 @@ static void SetVideoMode(void)
     SDL_RenderClear(renderer);
     SDL_RenderPresent(renderer);
 
-#ifndef CRISPY_TRUECOLOR
-    // Create the 8-bit paletted and the 32-bit RGBA screenbuffer surfaces.
-
-    if (screenbuffer != NULL)
-    {
-        SDL_FreeSurface(screenbuffer);
-        screenbuffer = NULL;
-    }
-
-    if (screenbuffer == NULL)
-    {
-        screenbuffer = SDL_CreateRGBSurface(0,
-                                            SCREENWIDTH, SCREENHEIGHT, 8,
-                                            0, 0, 0, 0);
-        SDL_FillRect(screenbuffer, NULL, 0);
-    }
-#endif
-
-    // Format of argbbuffer must match the screen pixel format because we
-    // import the surface data into the texture.
-
-    if (argbbuffer != NULL)
-    {
-        SDL_FreeSurface(argbbuffer);
-        argbbuffer = NULL;
-    }
-
-    if (argbbuffer == NULL)
-    {
-        SDL_PixelFormatEnumToMasks(pixel_format, &bpp,
-                                   &rmask, &gmask, &bmask, &amask);
-        argbbuffer = SDL_CreateRGBSurface(0,
-                                          SCREENWIDTH, SCREENHEIGHT, bpp,
-                                          rmask, gmask, bmask, amask);
-#ifdef CRISPY_TRUECOLOR
-        SDL_FillRect(argbbuffer, NULL, I_MapRGB(0xff, 0x0, 0x0));
-        redpane = SDL_CreateTextureFromSurface(renderer, argbbuffer);
-        SDL_SetTextureBlendMode(redpane, SDL_BLENDMODE_BLEND);
-
-        SDL_FillRect(argbbuffer, NULL, I_MapRGB(0xd7, 0xba, 0x45));
-        yelpane = SDL_CreateTextureFromSurface(renderer, argbbuffer);
-        SDL_SetTextureBlendMode(yelpane, SDL_BLENDMODE_BLEND);
-
-        SDL_FillRect(argbbuffer, NULL, I_MapRGB(0x0, 0xff, 0x0));
-        grnpane = SDL_CreateTextureFromSurface(renderer, argbbuffer);
-        SDL_SetTextureBlendMode(grnpane, SDL_BLENDMODE_BLEND);
-#endif
-        SDL_FillRect(argbbuffer, NULL, 0);
-    }
+    CreateFramebuffers();
 
     if (texture != NULL)
     {
@@ -1537,6 +2036,7 @@ static void SetVideoMode(void)
                                 pixel_format,
                                 SDL_TEXTUREACCESS_STREAMING,
                                 SCREENWIDTH, SCREENHEIGHT);
+    texture_stale = true;
 
     // Workaround for SDL 2.0.14+ alt-tab bug (taken from Doom Retro via Prboom-plus and Woof)
 #if defined(_WIN32)
@@ -1635,11 +2135,20 @@ void I_InitGraphics(void)
         putenv(winenv);
     }
 
-    SetSDLVideoDriver();
-
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) 
+    // [crispy] without a display, only the framebuffer surfaces get
+    // created and no SDL video subsystem is needed at all
+    if (headless)
     {
-        I_Error("Failed to initialize video: %s", SDL_GetError());
+        pixel_format = SDL_PIXELFORMAT_ARGB8888;
+    }
+    else
+    {
+        SetSDLVideoDriver();
+
+        if (SDL_Init(SDL_INIT_VIDEO) < 0)
+        {
+            I_Error("Failed to initialize video: %s", SDL_GetError());
+        }
     }
 
     // When in screensaver mode, run full screen and auto detect
@@ -1671,8 +2180,15 @@ void I_InitGraphics(void)
 
     // Create the game window; this may switch graphic modes depending
     // on configuration.
-    AdjustWindowSize();
-    SetVideoMode();
+    if (headless)
+    {
+        CreateFramebuffers();
+    }
+    else
+    {
+        AdjustWindowSize();
+        SetVideoMode();
+    }
 
 #ifndef CRISPY_TRUECOLOR
     // Start with a clear black screen
@@ -1687,15 +2203,40 @@ void I_InitGraphics(void)
     SDL_SetPaletteColors(screenbuffer->format->palette, palette, 0, 256);
 #endif
 
+#ifdef HAVE_EXPAND_AVX2
+    // [crispy] vectorized palette conversion
+    if (!M_ParmExists("-nosimd") && SDL_HasAVX2())
+    {
+        expand_row = ExpandRowAVX2;
+    }
+#endif
+
+    //!
+    // @category video
+    //
+    // Present each frame on a separate video thread. With an uncapped
+    // framerate, frames that run no new tic are rendered while the last
+    // one is presented. Input is only read once the last frame is on
+    // screen.
+    //
+
+    if (!headless && M_ParmExists("-videothread"))
+    {
+        StartVideoThread();
+    }
+
     // SDL2-TODO UpdateFocus();
-    UpdateGrab();
+    if (!headless)
+    {
+        UpdateGrab();
+    }
 
     // On some systems, it takes a second or so for the screen to settle
     // after changing modes.  We include the option to add a delay when
     // setting the screen mode, so that the game doesn't start immediately
     // with the player unable to see anything.
 
-    if (fullscreen && !screensaver_mode)
+    if (fullscreen && !screensaver_mode && !headless)
     {
         SDL_Delay(startup_delay);
     }
@@ -1718,7 +2259,10 @@ void I_InitGraphics(void)
 
     // clear out any events waiting at the start and center the mouse
   
-    while (SDL_PollEvent(&dummy));
+    if (!headless)
+    {
+        while (SDL_PollEvent(&dummy));
+    }
 
     initialized = true;
 
@@ -1731,6 +2275,15 @@ void I_InitGraphics(void)
 
 void I_ReInitGraphics (int reinit)
 {
+	// [crispy] there is no renderer and no window to adjust
+	if (headless)
+	{
+		reinit &= REINIT_FRAMEBUFFERS;
+	}
+
+	// [crispy] the video thread may still present from the old buffers
+	I_WaitVideoThread();
+
 	// [crispy] re-set rendering resolution and re-create framebuffers
 	if (reinit & REINIT_FRAMEBUFFERS)
 	{
@@ -1769,7 +2322,10 @@ void I_ReInitGraphics (int reinit)
 		V_RestoreBuffer();
 
 		// [crispy] it will get re-created below with the new resolution
-		SDL_DestroyTexture(texture);
+		if (!headless)
+		{
+			SDL_DestroyTexture(texture);
+		}
 	}
 
 	// [crispy] re-create renderer
@@ -1807,6 +2363,7 @@ void I_ReInitGraphics (int reinit)
 		                            pixel_format,
 		                            SDL_TEXTUREACCESS_STREAMING,
 		                            SCREENWIDTH, SCREENHEIGHT);
+		texture_stale = true;
 
 		// [crispy] force its re-creation
 		CreateUpscaledTexture(true);
@@ -1841,7 +2398,7 @@ void I_ReInitGraphics (int reinit)
 	}
 
 	// [crispy] adjust the window size and re-set the palette
-	need_resize = true;
+	need_resize = !headless;
 }
 
 // [crispy] take screenshot of the rendered image
@@ -1854,6 +2411,48 @@ void I_RenderReadPixels(byte **data, int *w, int *h, int *p)
 	uint32_t png_format;
 	byte *pixels;
 
+	// [crispy] native PNG pixel format
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+	png_format = SDL_PIXELFORMAT_RGB24;
+#else
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+	png_format = SDL_PIXELFORMAT_ABGR8888;
+#else
+	png_format = SDL_PIXELFORMAT_RGBA8888;
+#endif
+#endif
+	format = SDL_AllocFormat(png_format);
+
+	I_WaitVideoThread();
+
+	// [crispy] without a renderer, convert the unscaled framebuffer
+	if (headless)
+	{
+		temp = SCREENWIDTH * format->BytesPerPixel;
+		pixels = malloc(SCREENHEIGHT * temp);
+
+#ifndef CRISPY_TRUECOLOR
+		if (palette_to_set)
+		{
+			SDL_SetPaletteColors(screenbuffer->format->palette, palette, 0, 256);
+			palette_to_set = false;
+		}
+
+		SDL_LowerBlit(screenbuffer, &blit_rect, argbbuffer, &blit_rect);
+#endif
+		SDL_ConvertPixels(SCREENWIDTH, SCREENHEIGHT,
+		                  pixel_format, argbbuffer->pixels, argbbuffer->pitch,
+		                  format->format, pixels, temp);
+
+		*data = pixels;
+		*w = SCREENWIDTH;
+		*h = SCREENHEIGHT;
+		*p = temp;
+
+		SDL_FreeFormat(format);
+		return;
+	}
+
 	// [crispy] adjust cropping rectangle if necessary
 	rect.x = rect.y = 0;
 	SDL_GetRendererOutputSize(renderer, &rect.w, &rect.h);
@@ -1888,17 +2487,6 @@ void I_RenderReadPixels(byte **data, int *w, int *h, int *p)
 		}
 	}
 
-	// [crispy] native PNG pixel format
-#if SDL_VERSION_ATLEAST(2, 0, 5)
-	png_format = SDL_PIXELFORMAT_RGB24;
-#else
-#if SDL_BYTEORDER == SDL_LIL_ENDIAN
-	png_format = SDL_PIXELFORMAT_ABGR8888;
-#else
-	png_format = SDL_PIXELFORMAT_RGBA8888;
-#endif
-#endif
-	format = SDL_AllocFormat(png_format);
 	temp = rect.w * format->BytesPerPixel; // [crispy] pitch
 
 	// [crispy] As far as I understand the issue, SDL_RenderPresent()
@@ -1987,7 +2575,7 @@ const pixel_t I_BlendOver (const pixel_t bg, const pixel_t fg)
 	return amask | r | g | b;
 }
 
-const pixel_t (*blendfunc) (const pixel_t fg, const pixel_t bg) = I_BlendOver;
+THREADLOCAL const pixel_t (*blendfunc) (const pixel_t fg, const pixel_t bg) = I_BlendOver;
 
 const pixel_t I_MapRGB (const uint8_t r, const uint8_t g, const uint8_t b)
 {
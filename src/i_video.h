@@ -66,6 +66,7 @@ extern const pixel_t I_MapRGB (const uint8_t r, const uint8_t g, const uint8_t b
 
 void I_UpdateNoBlit (void);
 void I_FinishUpdate (void);
+void I_WaitVideoThread (void); // [crispy] pipelined presentation
 
 void I_ReadScreen (pixel_t* scr);
 
@@ -583,6 +583,16 @@ static default_t	doom_defaults_list[] =
 
     CONFIG_VARIABLE_INT(detaillevel),
 
+    //!
+    // @game doom
+    //
+    // Target time in milliseconds to draw a frame. If the frames take
+    // longer, the view is temporarily drawn in low detail. Zero
+    // disables this.
+    //
+
+    CONFIG_VARIABLE_INT(dynamic_resolution),
+
     //!
     // Number of sounds that will be played simultaneously.
     //
@@ -2095,6 +2105,15 @@ static default_t extra_defaults_list[] =
 
     CONFIG_VARIABLE_INT(crispy_flipcorpses),
 
+    //!
+    // @game doom
+    //
+    // Limit the uncapped framerate to this many frames per second,
+    // 0 for no limit.
+    //
+
+    CONFIG_VARIABLE_INT(crispy_fpslimit),
+
     //!
     // @game doom
     //
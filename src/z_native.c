@@ -45,6 +45,8 @@ struct memblock_s
  
 static memblock_t *allocated_blocks[PU_NUM_TAGS];
 
+static boolean purge_suspended;
+
 #ifdef TESTING
 
 static int test_malloced = 0;
@@ -255,7 +257,7 @@ void *Z_Malloc(int size, int tag, void *user)
 
         if (newblock == NULL)
         {
-            if (!ClearCache(sizeof(memblock_t) + size))
+            if (purge_suspended || !ClearCache(sizeof(memblock_t) + size))
             {
                 I_Error("Z_Malloc: failed on allocation of %i bytes", size);
             }
@@ -496,3 +498,13 @@ unsigned int Z_ZoneSize(void)
     return 0;
 }
 
+
+//
+// Z_SuspendPurge
+// While suspended, the cache is never cleared to satisfy an allocation.
+//
+
+void Z_SuspendPurge(boolean suspend)
+{
+    purge_suspended = suspend;
+}
@@ -67,6 +67,7 @@ typedef struct
 static memzone_t *mainzone;
 static boolean zero_on_free;
 static boolean scan_on_free;
+static boolean purge_suspended;
 
 
 //
@@ -295,7 +296,7 @@ Z_Malloc
 	
         if (rover->tag != PU_FREE)
         {
-            if (rover->tag < PU_PURGELEVEL)
+            if (rover->tag < PU_PURGELEVEL || purge_suspended)
             {
                 // hit a block that can't be purged,
                 // so move base past it
@@ -557,3 +558,13 @@ unsigned int Z_ZoneSize(void)
     return mainzone->size;
 }
 
+
+//
+// Z_SuspendPurge
+// While suspended, purgable blocks are left alone and the zone grows
+// instead, so that cached pointers handed out stay valid meanwhile.
+//
+void Z_SuspendPurge(boolean suspend)
+{
+    purge_suspended = suspend;
+}